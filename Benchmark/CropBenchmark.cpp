@@ -0,0 +1,115 @@
+// Compares copy_pixels_in_quad with the per-pixel implementation it replaced, on synthetic pages.
+// Both are checked to produce the same image before they are timed.
+
+#include "Image.hpp"
+#include "Core/Log.hpp"
+#include "Core/Quad.hpp"
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <string_view>
+
+namespace frog {
+
+// The implementation before scanline spans, kept here as the baseline.
+static PIX* copy_pixels_in_quad_per_pixel(PIX* source, const Quad& quad) {
+    const auto top = static_cast<int>(quad.top());
+    const auto bottom = static_cast<int>(quad.bottom());
+    const auto left = static_cast<int>(quad.left());
+    const auto right = static_cast<int>(quad.right());
+    auto destination = pixCreate(right - left, bottom - top, static_cast<int>(source->d));
+    pixSetBlackOrWhite(destination, L_SET_WHITE);
+    for (int y{ top }; y <= bottom; y++) {
+        for (int x{ left }; x <= right; x++) {
+            if (quad.contains(static_cast<float>(x), static_cast<float>(y))) {
+                l_uint32 pixel{};
+                pixGetPixel(source, x, y, &pixel);
+                pixSetPixel(destination, x - left, y - top, pixel);
+            }
+        }
+    }
+    return destination;
+}
+
+// An A4 page at 300 DPI filled with noise, so that every copied word matters.
+static PIX* make_noise_page(int depth) {
+    auto page = pixCreate(2480, 3508, depth);
+    auto data = pixGetData(page);
+    const auto wordCount = static_cast<std::size_t>(pixGetWpl(page)) * static_cast<std::size_t>(pixGetHeight(page));
+    std::uint32_t state{ 2463534242 };
+    for (std::size_t i{ 0 }; i < wordCount; i++) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        data[i] = state;
+    }
+    return page;
+}
+
+static Quad make_rotated_quad(float centerX, float centerY, float width, float height, float angleInDegrees) {
+    const auto radians = angleInDegrees * 3.14159265f / 180.0f;
+    const auto cos = std::cos(radians);
+    const auto sin = std::sin(radians);
+    const auto corner = [&](float x, float y) {
+        return std::array<float, 2>{ centerX + x * cos - y * sin, centerY + x * sin + y * cos };
+    };
+    const auto [x1, y1] = corner(-width / 2.0f, -height / 2.0f);
+    const auto [x2, y2] = corner(width / 2.0f, -height / 2.0f);
+    const auto [x3, y3] = corner(width / 2.0f, height / 2.0f);
+    const auto [x4, y4] = corner(-width / 2.0f, height / 2.0f);
+    Quad quad;
+    quad.x1 = x1;
+    quad.y1 = y1;
+    quad.x2 = x2;
+    quad.y2 = y2;
+    quad.x3 = x3;
+    quad.y3 = y3;
+    quad.x4 = x4;
+    quad.y4 = y4;
+    return quad;
+}
+
+template<typename Crop>
+static double time_crop_in_microseconds(Crop crop, PIX* page, const Quad& quad, int iterations) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i{ 0 }; i < iterations; i++) {
+        auto pix = crop(page, quad);
+        pixDestroy(&pix);
+    }
+    const std::chrono::duration<double, std::micro> duration{ std::chrono::steady_clock::now() - start };
+    return duration.count() / iterations;
+}
+
+static bool run_case(std::string_view name, PIX* page, const Quad& quad, int iterations) {
+    auto before = copy_pixels_in_quad_per_pixel(page, quad);
+    auto after = copy_pixels_in_quad(page, quad);
+    l_int32 same{};
+    pixEqual(before, after, &same);
+    pixDestroy(&before);
+    pixDestroy(&after);
+    if (same == 0) {
+        log::error("{} at {} bpp: the crops differ.", name, pixGetDepth(page));
+        return false;
+    }
+    const auto perPixel = time_crop_in_microseconds(copy_pixels_in_quad_per_pixel, page, quad, iterations);
+    const auto scanline = time_crop_in_microseconds(copy_pixels_in_quad, page, quad, iterations);
+    log::info("{} at {} bpp: per pixel {:.1f} us, scanline {:.1f} us ({:.1f}x)", name, pixGetDepth(page), perPixel, scanline, perPixel / scanline);
+    return true;
+}
+
+}
+
+int main() {
+    using namespace frog;
+    bool allSame{ true };
+    for (const int depth : { 8, 32 }) {
+        auto page = make_noise_page(depth);
+        allSame &= run_case("Text line", page, make_rotated_quad(1240.0f, 1000.0f, 1800.0f, 60.0f, 0.0f), 50);
+        allSame &= run_case("Skewed text line", page, make_rotated_quad(1240.0f, 1000.0f, 1800.0f, 60.0f, 3.0f), 50);
+        allSame &= run_case("Skewed text block", page, make_rotated_quad(1240.0f, 1700.0f, 2000.0f, 1200.0f, 7.0f), 5);
+        pixDestroy(&page);
+    }
+    return allSame ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+// Checks parse_pylaia_segmentation_words on the corpus and on random mutations of it, then compares its speed on a dense
+// page with the std::regex matching it replaced.
+// Usage: PyLaiaSegmentationBenchmark [corpus directory], which defaults to Benchmark/Corpus/PyLaiaSegmentation.
+
+#include "HuginMunin/PyLaiaSegmentation.hpp"
+#include "Core/Filesystem.hpp"
+#include "Core/Log.hpp"
+#include "Core/String.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <regex>
+#include <string>
+#include <utility>
+
+namespace frog {
+
+class Mutator {
+public:
+
+    std::string mutate(std::string_view input) {
+        std::string output{ input };
+        const auto mutationCount = 1 + next() % 4;
+        for (std::uint32_t i{ 0 }; i < mutationCount; i++) {
+            const auto index = output.empty() ? 0 : next() % output.size();
+            switch (next() % 4) {
+            case 0:
+                if (!output.empty()) {
+                    output[index] = pick_character();
+                }
+                break;
+            case 1:
+                output.insert(output.begin() + static_cast<std::ptrdiff_t>(index), pick_character());
+                break;
+            case 2:
+                if (!output.empty()) {
+                    output.erase(index, 1);
+                }
+                break;
+            default:
+                output.resize(index);
+                break;
+            }
+        }
+        return output;
+    }
+
+private:
+
+    // Mostly the characters the parser looks for, so mutations reach past the first token.
+    char pick_character() {
+        constexpr std::string_view characters{ "()[]'\"\\, -0123456789<>space" };
+        if (next() % 8 == 0) {
+            return static_cast<char>(next() % 256);
+        }
+        return characters[next() % characters.size()];
+    }
+
+    std::uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    std::uint32_t state{ 2463534242 };
+
+};
+
+static bool check_words(std::string_view line, const std::vector<PyLaiaSegmentationWord>& words) {
+    for (const auto& word : words) {
+        const auto inside = word.text.data() >= line.data() && word.text.data() + word.text.size() <= line.data() + line.size();
+        if (!inside || word.text == "<space>" || word.x < 0 || word.y < 0 || word.width < 0 || word.height < 0) {
+            log::error("Invalid word \"{}\" from: {}", word.text, line);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool check_text_equals() {
+    const std::pair<std::string_view, std::string_view> equal[]{
+        { "Hei", "Hei" }, { "it\\'s", "it's" }, { "back\\\\slash", "back\\slash" }, { "tab\\there", "tab\there" }, { "", "" }
+    };
+    const std::pair<std::string_view, std::string_view> different[]{
+        { "Hei", "Hei!" }, { "Hei!", "Hei" }, { "it\\'s", "it\\'s" }
+    };
+    for (const auto& [segmentationText, text] : equal) {
+        if (!pylaia_text_equals(segmentationText, text)) {
+            log::error("Expected {} to equal {}", segmentationText, text);
+            return false;
+        }
+    }
+    for (const auto& [segmentationText, text] : different) {
+        if (pylaia_text_equals(segmentationText, text)) {
+            log::error("Expected {} to differ from {}", segmentationText, text);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool check_corpus(const std::filesystem::path& directory) {
+    const auto files = files_in_directory(directory, false, ".txt");
+    if (files.empty()) {
+        log::error("No corpus found in {}", directory);
+        return false;
+    }
+    Mutator mutator;
+    std::vector<PyLaiaSegmentationWord> words;
+    for (const auto& file : files) {
+        const auto contents = read_file(file);
+        std::size_t wordCount{};
+        std::size_t mutationCount{};
+        for (const auto line : split_string_view(contents, "\n")) {
+            parse_pylaia_segmentation_words(line, words);
+            if (!check_words(line, words)) {
+                return false;
+            }
+            wordCount += words.size();
+            for (int i{ 0 }; i < 10000; i++) {
+                const auto mutated = mutator.mutate(line);
+                parse_pylaia_segmentation_words(mutated, words);
+                if (!check_words(mutated, words)) {
+                    return false;
+                }
+                mutationCount++;
+            }
+        }
+        log::info("{}: {} words, {} mutations", file.filename(), wordCount, mutationCount);
+    }
+    return true;
+}
+
+// A dense handwritten page: 40 lines of 30 words.
+static std::vector<std::string> make_dense_page() {
+    std::vector<std::string> lines;
+    for (int lineIndex{ 0 }; lineIndex < 40; lineIndex++) {
+        std::string line{ "[" };
+        int x{};
+        for (int wordIndex{ 0 }; wordIndex < 30; wordIndex++) {
+            line += fmt::format("('ord{}', {}, 0, {}, 128), ('<space>', {}, 0, {}, 128), ", wordIndex, x, x + 60, x + 60, x + 68);
+            x += 68;
+        }
+        line.resize(line.size() - 2);
+        line += "]";
+        lines.emplace_back(std::move(line));
+    }
+    return lines;
+}
+
+template<typename Parse>
+static double time_page_in_microseconds(Parse parse, const std::vector<std::string>& lines, int iterations) {
+    const auto start = std::chrono::steady_clock::now();
+    std::size_t wordCount{};
+    for (int i{ 0 }; i < iterations; i++) {
+        for (const auto& line : lines) {
+            wordCount += parse(line);
+        }
+    }
+    const std::chrono::duration<double, std::micro> duration{ std::chrono::steady_clock::now() - start };
+    if (wordCount == 0) {
+        log::warning("No words were parsed.");
+    }
+    return duration.count() / iterations;
+}
+
+static void benchmark_dense_page() {
+    const auto lines = make_dense_page();
+    std::vector<PyLaiaSegmentationWord> words;
+    const auto parse = [&](std::string_view line) {
+        parse_pylaia_segmentation_words(line, words);
+        return words.size();
+    };
+    // Only the matching of the previous implementation, which is what showed up in profiles.
+    const std::regex pattern{ R"(\(([^'\)]*('[^']*'[^'\)]*)*)\))" };
+    const auto match = [&](std::string_view line) {
+        std::size_t matchCount{};
+        for (std::cregex_iterator match{ line.data(), line.data() + line.size(), pattern }; match != std::cregex_iterator{}; match++) {
+            matchCount++;
+        }
+        return matchCount;
+    };
+    const auto parseTime = time_page_in_microseconds(parse, lines, 200);
+    const auto regexTime = time_page_in_microseconds(match, lines, 20);
+    log::info("Dense page: std::regex {:.1f} us, parser {:.1f} us ({:.1f}x)", regexTime, parseTime, regexTime / parseTime);
+}
+
+}
+
+int main(int argc, char** argv) {
+    using namespace frog;
+    const std::filesystem::path corpus{ argc > 1 ? argv[1] : "Benchmark/Corpus/PyLaiaSegmentation" };
+    if (!check_text_equals() || !check_corpus(corpus)) {
+        return 1;
+    }
+    benchmark_dense_page();
+    return 0;
+}
@@ -23,3 +23,20 @@ create table task (
 
 create index index_task_custom_data_1 on task (custom_data_1);
 create index index_task_custom_data_2 on task (custom_data_2);
+create index index_task_priority on task (priority desc, task_id);
+
+-- Inserts where every row was skipped by "on conflict do nothing" add no rows, and should not wake anyone.
+create function notify_task_added() returns trigger as $$
+begin
+    if exists (select 1 from inserted_tasks) then
+        perform pg_notify('task_added', '');
+    end if;
+    return null;
+end;
+$$ language plpgsql;
+
+create trigger trigger_task_added
+    after insert on task
+    referencing new table as inserted_tasks
+    for each statement
+    execute function notify_task_added();
@@ -26,30 +26,37 @@ Alto::Alto(const Document& document, std::string path, int width, int height) {
     }
     Page page{ document.language, width, height, document.physicalImageNumber, document.confidence.getNormalized(), document.rotationInDegrees };
     PrintSpace printSpace{ 0, 0, width, height };
-    for (const auto& block : document.blocks) {
+    for (const auto& block : document.blocks()) {
         ComposedBlock composedBlock;
-        for (const auto& paragraph : block.paragraphs) {
-            if (paragraph.lines.empty()) {
+        for (const auto& paragraph : document.paragraphs(block)) {
+            const auto lines = document.lines(paragraph);
+            if (lines.empty()) {
                 continue;
             }
             TextBlock textBlock;
             textBlock.rotation = paragraph.angleInDegrees;
-            for (const auto& line : paragraph.lines) {
-                if (line.words.empty()) {
+            for (const auto& line : lines) {
+                const auto words = document.words(line);
+                if (words.empty()) {
                     continue;
                 }
                 TextLine textLine;
                 textLine.styleRefs = line.styleRefs;
-                for (const auto& word: line.words) {
+                textLine.strings.reserve(words.size());
+                for (const auto& word: words) {
+                    const auto symbols = document.symbols(word);
                     std::vector<Glyph> glyphs;
-                    for (const auto& symbol : word.symbols) {
+                    glyphs.reserve(symbols.size());
+                    for (const auto& symbol : symbols) {
+                        const auto symbolVariants = document.variants(symbol);
                         std::vector<Variant> variants;
-                        for (const auto& variant: symbol.variants) {
-                            variants.emplace_back(variant.text, variant.confidence.getNormalized());
+                        variants.reserve(symbolVariants.size());
+                        for (const auto& variant: symbolVariants) {
+                            variants.emplace_back(std::string{ document.text(variant.text) }, variant.confidence.getNormalized());
                         }
-                        glyphs.emplace_back(symbol.text, symbol.confidence.getNormalized(), symbol.x, symbol.y, symbol.width, symbol.height, variants);
+                        glyphs.emplace_back(std::string{ document.text(symbol.text) }, symbol.confidence.getNormalized(), symbol.x, symbol.y, symbol.width, symbol.height, std::move(variants));
                     }
-                    textLine.strings.emplace_back(word.text, word.confidence.getNormalized(), word.x, word.y, word.width, word.height, word.angleInDegrees, glyphs, word.styleRefs);
+                    textLine.strings.emplace_back(std::string{ document.text(word.text) }, word.confidence.getNormalized(), word.x, word.y, word.width, word.height, word.angleInDegrees, std::move(glyphs), word.styleRefs);
                 }
                 textLine.setBoundingBox(line.x, line.y, line.width, line.height);
                 textBlock.textLines.emplace_back(std::move(textLine));
@@ -57,11 +64,11 @@ Alto::Alto(const Document& document, std::string path, int width, int height) {
             textBlock.setBoundingBox(paragraph.x, paragraph.y, paragraph.width, paragraph.height);
             composedBlock.textBlocks.emplace_back(std::move(textBlock));
         }
-        if (!block.detector.empty()) {
-            composedBlock.processingRefs.push_back(block.detector);
+        if (block.detector.size > 0) {
+            composedBlock.processingRefs.emplace_back(document.text(block.detector));
         }
-        if (!block.recognizer.empty()) {
-            composedBlock.processingRefs.push_back(block.recognizer);
+        if (block.recognizer.size > 0) {
+            composedBlock.processingRefs.emplace_back(document.text(block.recognizer));
         }
         composedBlock.setBoundingBox(block.x, block.y, block.width, block.height);
         printSpace.composedBlocks.emplace_back(std::move(composedBlock));
@@ -1,20 +1,24 @@
 #include "Application.hpp"
-#include "TaskProcessor.hpp"
+#include "TaskPipeline.hpp"
 #include "Core/XML/Library.hpp"
 #include "Image.hpp"
 #include "Core/Filesystem.hpp"
 #include "Core/Log.hpp"
-#include "Core/Database/Connection.hpp"
+#include "Core/Database/ConnectionPool.hpp"
 #include "Core/XML/Validator.hpp"
 #include "Install.hpp"
 #include "Core/SambaClient.hpp"
 
+#include <algorithm>
 #include <csignal>
 
 namespace frog {
 
 static bool running{ true };
 
+// Sent by the task table trigger whenever tasks are inserted.
+constexpr std::string_view task_added_channel{ "task_added" };
+
 void signal_handler(int signal) {
     running = false;
 }
@@ -59,17 +63,40 @@ std::string get_opencv_version() {
     return cv::getVersionString();
 }
 
-void delete_task(const database::Connection& database, std::int64_t taskId) {
-    database.execute(R"(delete from task where task_id = $1)", { std::to_string(taskId) });
-}
-
-void add_task(const database::Connection& database, std::string_view inputPath, std::string_view outputPath, std::int32_t priority, std::string_view customData1, std::int64_t customData2, std::string_view settings) {
-    database.execute(R"(
-        insert into task (input_path, output_path, priority, custom_data_1, custom_data_2, settings_csv)
-             values ($1, $2, $3, $4, $5, $6)
-    )", {
-        inputPath, outputPath, std::to_string(priority), customData1, std::to_string(customData2), settings
-    });
+AddTasksResult add_tasks(const database::Connection& database, std::span<const Task> tasks) {
+    constexpr std::size_t parametersPerTask{ 6 };
+    AddTasksResult result;
+    std::string query;
+    std::vector<std::string> parameters;
+    for (std::size_t batchOffset{ 0 }; batchOffset < tasks.size(); batchOffset += add_tasks_batch_size) {
+        const auto batch = tasks.subspan(batchOffset, std::min(add_tasks_batch_size, tasks.size() - batchOffset));
+        query = "insert into task (input_path, output_path, priority, custom_data_1, custom_data_2, settings_csv) values ";
+        parameters.clear();
+        parameters.reserve(batch.size() * parametersPerTask);
+        for (std::size_t i{ 0 }; i < batch.size(); i++) {
+            const auto first = i * parametersPerTask + 1;
+            query += fmt::format("{}(${}, ${}, ${}, ${}, ${}, ${})", i > 0 ? ", " : "", first, first + 1, first + 2, first + 3, first + 4, first + 5);
+            const auto& task = batch[i];
+            parameters.push_back(task.inputPath);
+            parameters.push_back(task.outputPath);
+            parameters.push_back(std::to_string(task.priority));
+            parameters.push_back(task.customData1);
+            parameters.push_back(std::to_string(task.customData2));
+            parameters.push_back(task.settingsCsv);
+        }
+        // Tasks that already exist are skipped, so that adding a partially added collection again is safe.
+        query += " on conflict do nothing";
+        const auto batchResult = database.execute(query, parameters);
+        if (batchResult.has_error()) {
+            log::error("Failed to add {} tasks: {}", batch.size(), batchResult.status_message());
+            result.failedCount += batch.size();
+            continue;
+        }
+        const auto insertedCount = static_cast<std::size_t>(batchResult.affected_count());
+        result.insertedCount += insertedCount;
+        result.skippedCount += batch.size() - insertedCount;
+    }
+    return result;
 }
 
 void show_versions() {
@@ -189,77 +216,92 @@ void cli_add(std::stack<std::string_view> arguments, const Config& config) {
     }
 
     fmt::print("Add tasks from path: {}\n", addTasksPath);
-    std::vector<std::pair<std::filesystem::path, std::filesystem::path>> newTaskPaths;
+    if (addTasksDatabaseIndex >= static_cast<int>(config.databases.size())) {
+        log::error("Database not configured: {}. There are {} databases configured.", addTasksDatabaseIndex, config.databases.size());
+        return;
+    }
+    const auto& databaseConfig = config.databases[addTasksDatabaseIndex];
+    const database::Connection database{ databaseConfig.host, databaseConfig.port, databaseConfig.name, databaseConfig.username, databaseConfig.password };
+    const auto& settingsCsv = settings.csv();
+
+    // Tasks are inserted in batches while the directory is still being walked.
+    AddTasksResult result;
+    std::vector<Task> newTasks;
+    newTasks.reserve(add_tasks_batch_size);
+    const auto flushNewTasks = [&] {
+        const auto batchResult = add_tasks(database, newTasks);
+        result.insertedCount += batchResult.insertedCount;
+        result.skippedCount += batchResult.skippedCount;
+        result.failedCount += batchResult.failedCount;
+        newTasks.clear();
+    };
+    const auto addNewTask = [&](const std::filesystem::path& inputPath, const std::filesystem::path& outputPath) {
+        Task task;
+        task.inputPath = path_to_string(inputPath);
+        task.outputPath = path_to_string(outputPath);
+        task.priority = priority;
+        task.customData1 = newTasksCustomData1;
+        task.customData2 = newTasksCustomData2;
+        task.settingsCsv = settingsCsv;
+        newTasks.emplace_back(std::move(task));
+        if (newTasks.size() >= add_tasks_batch_size) {
+            flushNewTasks();
+        }
+    };
+    const auto addNewTaskInDirectory = [&](const std::filesystem::path& inputPath) {
+        if (addTasksOutputPath.has_value()) {
+            const auto inputPathString = path_to_string(inputPath);
+            auto relativeInputPathString = inputPathString.substr(addTasksPath.size());
+            while (relativeInputPathString.starts_with('/')) {
+                relativeInputPathString.erase(0, 1);
+            }
+            addNewTask(inputPath, addTasksOutputPath.value() / path_with_extension(relativeInputPathString, "xml"));
+        } else {
+            addNewTask(inputPath, path_with_extension(inputPath, "xml"));
+        }
+    };
 
     if (addTasksPath.starts_with("smb://")) {
         auto sambaClient = acquire_samba_client();
+        if (!sambaClient) {
+            log::error("Samba client not configured. Unable to add tasks from {}", addTasksPath);
+            return;
+        }
         const auto inputPathFileType = sambaClient->getFileType(path_to_string(addTasksPath));
+        // The walker checks out its own clients from the pool.
+        release_samba_client(sambaClient);
         if (inputPathFileType == DirectoryEntryFileType::directory) {
-            const auto& inputPaths = sambaClient->getDirectoryFiles(path_to_string(addTasksPath), true);
-            newTaskPaths.reserve(inputPaths.size());
-            for (const auto& inputPath : inputPaths) {
-                if (!inputPath.ends_with(".jpg")) {
-                    continue;
-                }
-                if (addTasksOutputPath.has_value()) {
-                    const auto inputPathString = path_to_string(inputPath);
-                    auto relativeInputPathString = inputPathString.substr(addTasksPath.size());
-                    while (relativeInputPathString.starts_with('/')) {
-                        relativeInputPathString.erase(0, 1);
-                    }
-                    newTaskPaths.emplace_back(inputPath, addTasksOutputPath.value() / path_with_extension(relativeInputPathString, "xml"));
-                } else {
-                    newTaskPaths.emplace_back(inputPath, path_with_extension(inputPath, "xml"));
+            for_each_samba_directory_file(path_to_string(addTasksPath), config.sambaDirectoriesInFlight, [&](const std::string& inputPath) {
+                if (inputPath.ends_with(".jpg")) {
+                    addNewTaskInDirectory(inputPath);
                 }
-            }
+            });
         } else if (inputPathFileType == DirectoryEntryFileType::file) {
             if (addTasksOutputPath.has_value()) {
-                newTaskPaths.emplace_back(addTasksPath, addTasksOutputPath.value());
+                addNewTask(addTasksPath, addTasksOutputPath.value());
             } else {
-                newTaskPaths.emplace_back(addTasksPath, path_with_extension(addTasksPath, "xml"));
+                addNewTask(addTasksPath, path_with_extension(addTasksPath, "xml"));
             }
         }
-        release_samba_client();
     } else {
         if (std::filesystem::is_directory(addTasksPath)) {
-            const auto& inputPaths = files_in_directory(addTasksPath, true, ".jpg");
-            newTaskPaths.reserve(inputPaths.size());
-            for (const auto& inputPath : inputPaths) {
-                if (addTasksOutputPath.has_value()) {
-                    const auto inputPathString = path_to_string(inputPath);
-                    auto relativeInputPathString = inputPathString.substr(addTasksPath.size());
-                    while (relativeInputPathString.starts_with('/')) {
-                        relativeInputPathString.erase(0, 1);
-                    }
-                    newTaskPaths.emplace_back(inputPath, addTasksOutputPath.value() / path_with_extension(relativeInputPathString, "xml"));
-                } else {
-                    newTaskPaths.emplace_back(inputPath, path_with_extension(inputPath, "xml"));
-                }
-            }
+            for_each_file_in_directory(addTasksPath, true, ".jpg", addNewTaskInDirectory);
         } else if (std::filesystem::is_regular_file(addTasksPath)) {
             if (addTasksOutputPath.has_value()) {
-                newTaskPaths.emplace_back(addTasksPath, addTasksOutputPath.value());
+                addNewTask(addTasksPath, addTasksOutputPath.value());
             } else {
-                newTaskPaths.emplace_back(addTasksPath, path_with_extension(addTasksPath, "xml"));
+                addNewTask(addTasksPath, path_with_extension(addTasksPath, "xml"));
             }
         }
     }
-
-    if (newTaskPaths.empty()) {
+    flushNewTasks();
+    if (result.insertedCount + result.skippedCount + result.failedCount == 0) {
         log::error("No directory or file found at specified path.");
         return;
     }
-    if (addTasksDatabaseIndex >= static_cast<int>(config.databases.size())) {
-        log::error("Database not configured: {}. There are {} databases configured.", addTasksDatabaseIndex, config.databases.size());
-        return;
-    }
-    const auto& databaseConfig = config.databases[addTasksDatabaseIndex];
-    const database::Connection database{ databaseConfig.host, databaseConfig.port, databaseConfig.name, databaseConfig.username, databaseConfig.password };
-    const auto& settingsCsv = settings.csv();
-    for (const auto& [inputPath, outputPath] : newTaskPaths) {
-        const auto inputPathString = path_to_string(inputPath);
-        const auto outputPathString = path_to_string(outputPath);
-        add_task(database, inputPathString, outputPathString, priority, newTasksCustomData1, newTasksCustomData2, settingsCsv);
+    log::info("Added {} tasks. Skipped {} tasks that already exist.", result.insertedCount, result.skippedCount);
+    if (result.failedCount > 0) {
+        log::error("Failed to add {} tasks.", result.failedCount);
     }
 }
 
@@ -278,62 +320,95 @@ void cli_process(std::stack<std::string_view> arguments, const Config& config) {
     }
     const auto& profile = config.profiles.front();
 
-    std::vector<std::unique_ptr<TaskProcessor>> processors;
-    for (int i{ 0 }; i < config.maxThreadCount; i++) {
-        processors.emplace_back(std::make_unique<TaskProcessor>(profile));
+    BlockingQueue<Task> taskQueue;
+    auto pipeline = std::make_unique<TaskPipeline>(config, profile, taskQueue);
+    log::info("Initialized {} task processors", pipeline->getProcessorCount());
+
+    // Connections are kept open across iterations, and reconnected with backoff if they are lost.
+    std::vector<std::unique_ptr<database::ConnectionPool>> databasePools;
+    for (const auto& databaseConfig : config.databases) {
+        auto& databasePool = databasePools.emplace_back(std::make_unique<database::ConnectionPool>(
+            databaseConfig.host, databaseConfig.port, databaseConfig.name, databaseConfig.username, databaseConfig.password,
+            std::chrono::seconds{ config.retryDatabaseConnectionIntervalSeconds }
+        ));
+        // Listen before fetching, so tasks added between the fetch and the wait still wake us up.
+        databasePool->listen(task_added_channel);
     }
-    log::info("Initialized {} task processors", processors.size());
 
+    const auto maxQueuedTaskCount = static_cast<std::size_t>(std::max(config.maxThreadCount * config.maxTasksPerThread, 1));
+    // Refill the shared queue before it runs dry, but only once there is room for a sizeable batch, and always for at least one task.
+    const auto refillQueuedTaskCount = std::min(static_cast<std::size_t>(std::max(config.maxThreadCount, 0)), maxQueuedTaskCount - 1);
     while (running) {
-        std::vector<std::unique_ptr<database::Connection>> databaseConnections;
-        for (const auto& databaseConfig : config.databases) {
-            auto connection = std::make_unique<database::Connection>(databaseConfig.host, databaseConfig.port, databaseConfig.name, databaseConfig.username, databaseConfig.password);
-            if (connection->has_error()) {
-                log::warning("Failed to connect to database {} at {}", databaseConfig.name, databaseConfig.host);
-            } else {
-                databaseConnections.emplace_back(std::move(connection));
+        taskQueue.waitUntilSizeAtMost(refillQueuedTaskCount);
+        if (!running) {
+            break;
+        }
+        std::vector<database::ConnectionLease> databaseConnections;
+        for (const auto& databasePool : databasePools) {
+            if (auto connection = databasePool->acquire()) {
+                databaseConnections.emplace_back(std::move(*connection));
             }
         }
         if (databaseConnections.empty()) {
-            log::warning("Failed to connect to database. Trying again in {} seconds.", config.retryDatabaseConnectionIntervalSeconds);
-            std::this_thread::sleep_for(std::chrono::seconds{ config.retryDatabaseConnectionIntervalSeconds });
+            auto retryDelay = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::seconds{ config.retryDatabaseConnectionIntervalSeconds });
+            for (const auto& databasePool : databasePools) {
+                retryDelay = std::min(retryDelay, std::max(databasePool->retry_delay(), std::chrono::milliseconds{ 100 }));
+            }
+            log::warning("Failed to connect to database. Trying again in {} ms.", retryDelay.count());
+            std::this_thread::sleep_for(retryDelay);
             continue;
         }
+        const auto fetchCount = static_cast<int>(maxQueuedTaskCount - std::min(maxQueuedTaskCount, taskQueue.size()));
+        if (fetchCount == 0) {
+            continue; // The queue was filled while connecting. Only an empty fetch means there are no tasks.
+        }
         std::vector<Task> tasks;
-        for (const auto& databaseConnection : databaseConnections) {
-            tasks = fetch_next_tasks(*databaseConnection, config.maxThreadCount * config.maxTasksPerThread);
+        bool fetchFailed{ false };
+        for (auto& databaseConnection : databaseConnections) {
+            // A failed claim is not committed, so it is retried once on a fresh connection.
+            auto fetchedTasks = fetch_next_tasks(*databaseConnection, fetchCount);
+            if (!fetchedTasks.has_value() && databaseConnection.reconnect()) {
+                fetchedTasks = fetch_next_tasks(*databaseConnection, fetchCount);
+            }
+            if (!fetchedTasks.has_value()) {
+                fetchFailed = true;
+                continue;
+            }
+            tasks = std::move(fetchedTasks.value());
             if (!tasks.empty()) {
                 break;
             }
         }
+        if (tasks.empty() && fetchFailed) {
+            // Not the same as an empty queue. The tasks are still in the database, so do not exit.
+            log::warning("Failed to fetch tasks. Trying again in {} seconds.", config.retryDatabaseConnectionIntervalSeconds);
+            std::this_thread::sleep_for(std::chrono::seconds{ config.retryDatabaseConnectionIntervalSeconds });
+            continue;
+        }
         if (tasks.empty()) {
             if (exitIfNoTasks) {
                 log::info("No tasks in queue. Preparing to exit.");
                 running = false;
             } else {
-                log::info("No tasks in queue. Checking again in {} seconds.", config.emptyTaskQueueSleepIntervalSeconds);
-                std::this_thread::sleep_for(std::chrono::seconds{ config.emptyTaskQueueSleepIntervalSeconds });
-            }
-        }
-        while (!tasks.empty()) {
-            for (auto& processor: processors) {
-                if (processor->getRemainingTaskCount() > config.maxTasksPerThread) {
-                    continue;
+                log::info("No tasks in queue. Waiting for new tasks, or checking again in {} seconds.", config.emptyTaskQueueSleepIntervalSeconds);
+                std::vector<const database::Connection*> listeningConnections;
+                for (const auto& databaseConnection : databaseConnections) {
+                    listeningConnections.push_back(databaseConnection.get());
                 }
-                processor->pushTask(tasks.back());
-                if (processor->isFinished()) {
-                    processor->relaunch();
-                }
-                tasks.pop_back();
-                if (tasks.empty()) {
-                    break;
+                if (database::wait_for_notification(listeningConnections, std::chrono::seconds{ config.emptyTaskQueueSleepIntervalSeconds })) {
+                    log::info("Notified of new tasks.");
                 }
             }
-            if (!tasks.empty()) {
-                std::this_thread::sleep_for(std::chrono::milliseconds{ 500 });
-            }
+        }
+        // Tasks are ordered by priority, and the queue is first in, first out.
+        for (auto& task : tasks) {
+            taskQueue.push(std::move(task));
         }
     }
+
+    // Tasks have already been removed from the database, so let the workers finish what is queued.
+    taskQueue.close();
+    pipeline.reset();
 }
 
 void cli_validate(std::stack<std::string_view> arguments, const Config& config) {
@@ -351,6 +426,10 @@ void cli_validate(std::stack<std::string_view> arguments, const Config& config)
     SambaClient* sambaClient{};
     if (validatePath.starts_with("smb://")) {
         sambaClient = acquire_samba_client();
+        if (!sambaClient) {
+            log::error("Samba client not configured. Unable to validate {}", validatePath);
+            return;
+        }
         const auto validatePathFileType = sambaClient->getFileType(validatePath);
         if (validatePathFileType == DirectoryEntryFileType::directory) {
             validatePaths = sambaClient->getDirectoryFiles(validatePath, true);
@@ -372,7 +451,7 @@ void cli_validate(std::stack<std::string_view> arguments, const Config& config)
     if (validatePaths.empty()) {
         log::error("No directory or file found at specified path.");
         if (sambaClient) {
-            release_samba_client();
+            release_samba_client(sambaClient);
         }
         return;
     }
@@ -403,7 +482,7 @@ void cli_validate(std::stack<std::string_view> arguments, const Config& config)
         }
     }
     if (sambaClient) {
-        release_samba_client();
+        release_samba_client(sambaClient);
     }
 }
 
@@ -472,7 +551,7 @@ void start() {
         }
     }
 
-    initialize_samba_client(config.sambaCredentials);
+    initialize_samba_client(config.sambaCredentials, config.sambaClientCount > 0 ? config.sambaClientCount : config.maxThreadCount);
 
     if (commandName == "add") {
         cli_add(arguments, config);
@@ -490,34 +569,49 @@ void start() {
     }
 }
 
-std::vector<Task> fetch_next_tasks(const database::Connection& database, int count) {
+std::optional<std::vector<Task>> fetch_next_tasks(const database::Connection& database, int count) {
     log::info("Fetching next {} tasks", count);
-    const auto result = database.execute(fmt::format(R"(
-           select task_id,
-                  input_path,
-                  output_path,
-                  custom_data_1,
-                  custom_data_2,
-                  settings_csv
-             from task
-         order by priority desc
-            limit {}
-    )", count));
+    // Claim and remove the tasks in one statement. Rows locked by another worker are skipped rather than waited on,
+    // so several processes can drain the same queue without claiming the same task twice.
+    const auto result = database.execute(R"(
+        delete from task
+              where task_id in (
+                       select task_id
+                         from task
+                     order by priority desc, task_id
+                        limit $1
+                   for update skip locked
+                    )
+          returning task_id,
+                    input_path,
+                    output_path,
+                    priority,
+                    custom_data_1,
+                    custom_data_2,
+                    settings_csv
+    )", { std::to_string(count) });
+    if (result.has_error()) {
+        log::error("Failed to fetch tasks: {}", result.status_message());
+        return std::nullopt;
+    }
     std::vector<Task> tasks;
+    tasks.reserve(static_cast<std::size_t>(result.count()));
     for (int i{ 0 }; i < result.count(); i++) {
         const auto row = result.row(i);
         Task task;
         task.taskId = row.long_integer("task_id");
         task.inputPath = row.text("input_path");
         task.outputPath = row.text("output_path");
+        task.priority = row.integer("priority");
         task.customData1 = row.text("custom_data_1");
         task.customData2 = row.long_integer("custom_data_2");
         task.settingsCsv = row.text("settings_csv");
         tasks.emplace_back(std::move(task));
     }
-    for (const auto& task: tasks) {
-        delete_task(database, task.taskId);
-    }
+    // The returning clause does not preserve the order of the subquery.
+    std::ranges::sort(tasks, [](const Task& a, const Task& b) {
+        return a.priority != b.priority ? a.priority > b.priority : a.taskId < b.taskId;
+    });
     return tasks;
 }
 
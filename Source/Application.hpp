@@ -13,6 +13,7 @@
 #include <stack>
 #include <thread>
 #include <memory>
+#include <span>
 #include <mutex>
 
 namespace frog::database {
@@ -32,7 +33,18 @@ struct Config;
 
 void start();
 
-std::vector<Task> fetch_next_tasks(const database::Connection& database, int count);
+struct AddTasksResult {
+    std::size_t insertedCount{};
+    std::size_t skippedCount{}; // The input or output path is already used by another task.
+    std::size_t failedCount{};
+};
+
+// Rows per insert statement. Each row has 6 parameters, and PostgreSQL allows up to 65535 per statement.
+constexpr std::size_t add_tasks_batch_size{ 1000 };
+
+// Returns std::nullopt if the query failed, which is not the same as there being no tasks.
+std::optional<std::vector<Task>> fetch_next_tasks(const database::Connection& database, int count);
+AddTasksResult add_tasks(const database::Connection& database, std::span<const Task> tasks);
 
 std::filesystem::path launch_path();
 std::stack<std::string_view> launch_arguments();
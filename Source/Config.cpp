@@ -11,6 +11,12 @@ TesseractConfig load_tesseract_config_xml(xml::Node rootNode) {
             config.tessdata = node.getContent();
         } else if (node.getName() == "Dataset") {
             config.dataset = node.getContent();
+        } else if (node.getName() == "EngineCount") {
+            config.engineCount = std::max(from_string<int>(node.getContent()).value_or(0), 0);
+        } else if (node.getName() == "EngineMemoryLimitMegabytes") {
+            config.engineMemoryLimitMegabytes = std::max(from_string<int>(node.getContent()).value_or(0), 0);
+        } else if (node.getName() == "MaxEnginesPerPage") {
+            config.maxEnginesPerPage = std::max(from_string<int>(node.getContent()).value_or(1), 1);
         }
     }
     if (config.tessdata.empty()) {
@@ -24,11 +30,29 @@ TesseractConfig load_tesseract_config_xml(xml::Node rootNode) {
     return config;
 }
 
+PaddleBatchingConfig load_paddle_batching_config_xml(xml::Node rootNode) {
+    PaddleBatchingConfig config;
+    for (auto node : rootNode.getChildren()) {
+        if (node.getName() == "MaxBatchSize") {
+            config.maxBatchSize = std::max(from_string<int>(node.getContent()).value_or(32), 1);
+        } else if (node.getName() == "MaxLatencyMilliseconds") {
+            config.maxLatencyMilliseconds = std::max(from_string<int>(node.getContent()).value_or(5), 0);
+        } else if (node.getName() == "PredictorCount") {
+            config.predictorCount = std::max(from_string<int>(node.getContent()).value_or(2), 1);
+        } else if (node.getName() == "MathThreadCount") {
+            config.mathThreadCount = std::max(from_string<int>(node.getContent()).value_or(4), 1);
+        }
+    }
+    return config;
+}
+
 PaddleTextDetectorConfig load_paddle_text_detector_config_xml(xml::Node rootNode) {
     PaddleTextDetectorConfig config;
     for (auto node : rootNode.getChildren()) {
         if (node.getName() == "Model") {
             config.model = node.getContent();
+        } else if (node.getName() == "Batching") {
+            config.batching = load_paddle_batching_config_xml(node);
         }
     }
     if (config.model.empty()) {
@@ -37,11 +61,37 @@ PaddleTextDetectorConfig load_paddle_text_detector_config_xml(xml::Node rootNode
     return config;
 }
 
+PaddleTextRecognizerConfig load_paddle_text_recognizer_config_xml(xml::Node rootNode) {
+    PaddleTextRecognizerConfig config;
+    for (auto node : rootNode.getChildren()) {
+        if (node.getName() == "Model") {
+            config.model = node.getContent();
+        } else if (node.getName() == "Labels") {
+            config.labels = node.getContent();
+        } else if (node.getName() == "BatchSize") {
+            config.batchSize = std::max(from_string<int>(node.getContent()).value_or(8), 1);
+        } else if (node.getName() == "Batching") {
+            config.batching = load_paddle_batching_config_xml(node);
+        }
+    }
+    if (config.model.empty()) {
+        log::error("Paddle text recognizer XML configuration is missing model, and will not work.");
+    }
+    if (config.labels.empty()) {
+        log::error("Paddle text recognizer XML configuration is missing labels, and will not work.");
+    }
+    return config;
+}
+
 PaddleTextAngleClassifierConfig load_paddle_orientation_classifier_config_xml(xml::Node rootNode) {
     PaddleTextAngleClassifierConfig config;
     for (auto node : rootNode.getChildren()) {
         if (node.getName() == "Model") {
             config.model = node.getContent();
+        } else if (node.getName() == "BatchSize") {
+            config.batchSize = std::max(from_string<int>(node.getContent()).value_or(16), 1);
+        } else if (node.getName() == "Batching") {
+            config.batching = load_paddle_batching_config_xml(node);
         }
     }
     if (config.model.empty()) {
@@ -55,10 +105,18 @@ HuginMuninTextRecognizerConfig load_hugin_munin_text_recognizer_config_xml(xml::
     for (auto node : rootNode.getChildren()) {
         if (node.getName() == "PyLaiaHtrDecodeCtcPath") {
             config.pylaiaHtrDecodeCtcPath = node.getContent();
+        } else if (node.getName() == "MaxBatchSize") {
+            config.maxBatchSize = std::max(from_string<int>(node.getContent()).value_or(64), 1);
+        } else if (node.getName() == "MaxBatchLatencyMilliseconds") {
+            config.maxBatchLatencyMilliseconds = std::max(from_string<int>(node.getContent()).value_or(20), 0);
+        } else if (node.getName() == "Python") {
+            config.python = node.getContent();
         } else if (node.getName() == "ModelDirectory") {
             config.modelDirectory = node.getContent();
         } else if (node.getName() == "TemporaryStorageDirectory") {
             config.temporaryStorageDirectory = node.getContent();
+        } else if (node.getName() == "WorkerCount") {
+            config.workerCount = std::max(from_string<int>(node.getContent()).value_or(1), 1);
         }
     }
     if (config.modelDirectory.empty()) {
@@ -79,6 +137,8 @@ HuginMuninTextDetectorConfig load_hugin_munin_text_detector_config_xml(xml::Node
             config.model = node.getContent();
         } else if (node.getName() == "TemporaryStorageDirectory") {
             config.temporaryStorageDirectory = node.getContent();
+        } else if (node.getName() == "WorkerCount") {
+            config.workerCount = std::max(from_string<int>(node.getContent()).value_or(1), 1);
         }
     }
     if (config.model.empty()) {
@@ -97,6 +157,8 @@ Profile load_profile_xml(xml::Node rootNode) {
             profile.tesseract = load_tesseract_config_xml(node);
         } else if (node.getName() == "PaddleTextDetector") {
             profile.paddleTextDetector = load_paddle_text_detector_config_xml(node);
+        } else if (node.getName() == "PaddleTextRecognizer") {
+            profile.paddleTextRecognizer = load_paddle_text_recognizer_config_xml(node);
         } else if (node.getName() == "PaddleTextAngleClassifier") {
             profile.paddleTextOrientationClassifier = load_paddle_orientation_classifier_config_xml(node);
         } else if (node.getName() == "HuginMuninTextDetector") {
@@ -126,6 +188,28 @@ DatabaseConfig load_database_config_xml(xml::Node rootNode) {
     return config;
 }
 
+PipelineConfig load_pipeline_config_xml(xml::Node rootNode) {
+    PipelineConfig config;
+    for (auto node : rootNode.getChildren()) {
+        if (node.getName() == "LoadThreadCount") {
+            config.loadThreadCount = from_string<int>(node.getContent()).value_or(2);
+        } else if (node.getName() == "SaveThreadCount") {
+            config.saveThreadCount = from_string<int>(node.getContent()).value_or(2);
+        } else if (node.getName() == "QueueCapacity") {
+            config.queueCapacity = from_string<int>(node.getContent()).value_or(0);
+        }
+    }
+    if (config.loadThreadCount < 1) {
+        log::warning("Pipeline needs at least one load thread. Using 1.");
+        config.loadThreadCount = 1;
+    }
+    if (config.saveThreadCount < 1) {
+        log::warning("Pipeline needs at least one save thread. Using 1.");
+        config.saveThreadCount = 1;
+    }
+    return config;
+}
+
 SambaCredentialsConfig load_samba_credentials_config_xml(xml::Node rootNode) {
     SambaCredentialsConfig config;
     for (auto node : rootNode.getChildren()) {
@@ -154,12 +238,24 @@ Config::Config(xml::Document document) {
             retryDatabaseConnectionIntervalSeconds = from_string<int>(node.getContent()).value_or(300);
         } else if (node.getName() == "EmptyTaskQueueSleepIntervalSeconds") {
             emptyTaskQueueSleepIntervalSeconds = from_string<int>(node.getContent()).value_or(30);
+        } else if (node.getName() == "ReadAheadTaskCount") {
+            readAheadTaskCount = from_string<int>(node.getContent()).value_or(0);
+        } else if (node.getName() == "ReadAheadMemoryBudgetMegabytes") {
+            readAheadMemoryBudgetMegabytes = from_string<int>(node.getContent()).value_or(1024);
+        } else if (node.getName() == "LatencyModeMaxQueuedTasks") {
+            latencyModeMaxQueuedTasks = std::max(from_string<int>(node.getContent()).value_or(0), 0);
+        } else if (node.getName() == "Pipeline") {
+            pipeline = load_pipeline_config_xml(node);
         } else if (node.getName() == "Database") {
             databases.emplace_back(load_database_config_xml(node));
         } else if (node.getName() == "Profile") {
             profiles.emplace_back(load_profile_xml(node));
         } else if (node.getName() == "SambaCredentials") {
             sambaCredentials.emplace_back(load_samba_credentials_config_xml(node));
+        } else if (node.getName() == "SambaClientCount") {
+            sambaClientCount = from_string<int>(node.getContent()).value_or(0);
+        } else if (node.getName() == "SambaDirectoriesInFlight") {
+            sambaDirectoriesInFlight = std::max(from_string<int>(node.getContent()).value_or(4), 1);
         }
     }
 }
@@ -13,42 +13,72 @@ struct SambaCredentialsConfig {
 struct TesseractConfig {
     std::filesystem::path tessdata;
     std::string dataset;
+    int engineCount{}; // Engines shared by all processing threads. 0 means one per processing thread.
+    int engineMemoryLimitMegabytes{}; // Approximate limit for loaded datasets across engines. 0 means no limit.
+    int maxEnginesPerPage{ 1 }; // Engines the lines of one page may be split between in latency mode. 1 disables latency mode.
+};
+
+// When configured for a Paddle model, inference requests from every processing thread are gathered into shared batches.
+struct PaddleBatchingConfig {
+    int maxBatchSize{ 32 };
+    int maxLatencyMilliseconds{ 5 }; // How long a request may wait for a batch to fill up.
+    int predictorCount{ 2 }; // Batches run concurrently.
+    int mathThreadCount{ 4 }; // CPU math library threads per predictor.
 };
 
 struct PaddleTextDetectorConfig {
     std::filesystem::path model;
+    std::optional<PaddleBatchingConfig> batching;
 };
 
 struct PaddleTextRecognizerConfig {
     std::filesystem::path model;
     std::filesystem::path labels;
+    int batchSize{ 8 }; // Text lines recognized per inference run.
+    std::optional<PaddleBatchingConfig> batching;
 };
 
 struct PaddleTextAngleClassifierConfig {
     std::filesystem::path model;
+    int batchSize{ 16 }; // Text lines classified per inference run.
+    std::optional<PaddleBatchingConfig> batching;
 };
 
 struct HuginMuninTextRecognizerConfig {
-    std::string pylaiaHtrDecodeCtcPath;
+    std::string pylaiaHtrDecodeCtcPath; // Only used to find Python, if it is not set.
+    std::string python;
     std::string modelDirectory;
     std::string temporaryStorageDirectory;
+    int workerCount{ 1 }; // PyLaia processes shared by all processing threads.
+    int maxBatchSize{ 64 }; // Lines decoded together, from one or more pages.
+    int maxBatchLatencyMilliseconds{ 20 }; // How long lines may wait for lines from other pages.
 };
 
 struct HuginMuninTextDetectorConfig {
     std::string python;
     std::string model;
     std::string temporaryStorageDirectory;
+    int workerCount{ 1 }; // Doc-UFCN processes shared by all processing threads.
 };
 
 struct Profile {
     std::string name;
     std::optional<TesseractConfig> tesseract;
     std::optional<PaddleTextDetectorConfig> paddleTextDetector;
+    std::optional<PaddleTextRecognizerConfig> paddleTextRecognizer;
     std::optional<PaddleTextAngleClassifierConfig> paddleTextOrientationClassifier;
     std::optional<HuginMuninTextRecognizerConfig> huginMuninTextRecognizer;
     std::optional<HuginMuninTextDetectorConfig> huginMuninTextDetector;
 };
 
+// When configured, tasks are processed in stages with their own threads, so that reading and writing files
+// does not stall the threads running text detection and recognition.
+struct PipelineConfig {
+    int loadThreadCount{ 2 };
+    int saveThreadCount{ 2 };
+    int queueCapacity{}; // 0 means one task per processing thread.
+};
+
 struct DatabaseConfig {
     std::string host;
     int port{ 5432 };
@@ -63,10 +93,16 @@ struct Config {
     int maxTasksPerThread{ 50 };
     int retryDatabaseConnectionIntervalSeconds{ 300 };
     int emptyTaskQueueSleepIntervalSeconds{ 30 };
+    int readAheadTaskCount{}; // Images each processing thread reads and decodes ahead of time.
+    int readAheadMemoryBudgetMegabytes{ 1024 }; // Limit for decoded images waiting to be processed.
+    int latencyModeMaxQueuedTasks{}; // Pages are split between several Tesseract engines while at most this many tasks are waiting.
     std::filesystem::path schemas;
+    std::optional<PipelineConfig> pipeline;
     std::vector<DatabaseConfig> databases;
     std::vector<Profile> profiles;
     std::vector<SambaCredentialsConfig> sambaCredentials;
+    int sambaClientCount{}; // 0 means one per processing thread.
+    int sambaDirectoriesInFlight{ 4 }; // Directories listed concurrently when adding tasks from a share.
 
     Config() = default;
     Config(xml::Document document);
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+namespace frog {
+
+// Multi-producer multi-consumer queue. Consumers block until an item is available or the queue is closed.
+// Producers block while the queue is full, unless the capacity is 0, which means the queue is unbounded.
+template<typename T>
+class BlockingQueue {
+public:
+
+    BlockingQueue(std::size_t capacity = 0) : capacity{ capacity } {}
+    BlockingQueue(const BlockingQueue&) = delete;
+    BlockingQueue(BlockingQueue&&) = delete;
+
+    ~BlockingQueue() = default;
+
+    BlockingQueue& operator=(const BlockingQueue&) = delete;
+    BlockingQueue& operator=(BlockingQueue&&) = delete;
+
+    // Returns false if the queue was closed, in which case the item is dropped.
+    bool push(T item) {
+        std::unique_lock lock{ mutex };
+        notFull.wait(lock, [this] {
+            return closed || capacity == 0 || items.size() < capacity;
+        });
+        if (closed) {
+            return false;
+        }
+        items.emplace_back(std::move(item));
+        lock.unlock();
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Blocks until an item is available. Returns std::nullopt once the queue is closed and drained.
+    std::optional<T> pop() {
+        std::unique_lock lock{ mutex };
+        notEmpty.wait(lock, [this] {
+            return closed || !items.empty();
+        });
+        if (items.empty()) {
+            return std::nullopt;
+        }
+        auto item = std::move(items.front());
+        items.pop_front();
+        lock.unlock();
+        notFull.notify_one();
+        drained.notify_all();
+        return item;
+    }
+
+    std::optional<T> tryPop() {
+        std::unique_lock lock{ mutex };
+        if (items.empty()) {
+            return std::nullopt;
+        }
+        auto item = std::move(items.front());
+        items.pop_front();
+        lock.unlock();
+        notFull.notify_one();
+        drained.notify_all();
+        return item;
+    }
+
+    // Blocks until at most maxSize items are waiting, or the queue is closed.
+    void waitUntilSizeAtMost(std::size_t maxSize) {
+        std::unique_lock lock{ mutex };
+        drained.wait(lock, [this, maxSize] {
+            return closed || items.size() <= maxSize;
+        });
+    }
+
+    // Wakes up all waiting producers and consumers. Items already in the queue can still be popped.
+    void close() {
+        {
+            std::lock_guard lock{ mutex };
+            closed = true;
+        }
+        notEmpty.notify_all();
+        notFull.notify_all();
+        drained.notify_all();
+    }
+
+    [[nodiscard]] std::size_t size() const {
+        std::lock_guard lock{ mutex };
+        return items.size();
+    }
+
+    [[nodiscard]] bool isClosed() const {
+        std::lock_guard lock{ mutex };
+        return closed;
+    }
+
+private:
+
+    mutable std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::condition_variable drained;
+    std::deque<T> items;
+    const std::size_t capacity;
+    bool closed{ false };
+
+};
+
+}
@@ -1,6 +1,8 @@
 #include "Connection.hpp"
 #include "Core/Log.hpp"
 
+#include <poll.h>
+
 namespace frog::database {
 
 Connection::Connection(std::string_view host, int port, std::string_view database_name, std::string_view user, std::string_view password) {
@@ -63,4 +65,78 @@ std::string Connection::status_message() const {
     return PQerrorMessage(connection);
 }
 
+bool Connection::is_alive() const {
+    if (has_error()) {
+        return false;
+    }
+    // Notifications read here stay queued in libpq until consume_notifications().
+    return PQconsumeInput(connection) != 0 && !has_error();
+}
+
+bool Connection::reset() {
+    PQreset(connection);
+    return !has_error();
+}
+
+bool Connection::listen(std::string_view channel) const {
+    char* escapedChannel = PQescapeIdentifier(connection, channel.data(), channel.size());
+    if (!escapedChannel) {
+        log::error("Failed to escape channel name {}: {}", channel, status_message());
+        return false;
+    }
+    const auto result = execute(fmt::format("listen {}", escapedChannel));
+    PQfreemem(escapedChannel);
+    return !result.has_error();
+}
+
+std::vector<std::string> Connection::consume_notifications() const {
+    std::vector<std::string> channels;
+    if (PQconsumeInput(connection) == 0) {
+        log::warning("Failed to read notifications: {}", status_message());
+        return channels;
+    }
+    while (PGnotify* notification = PQnotifies(connection)) {
+        channels.emplace_back(notification->relname);
+        PQfreemem(notification);
+    }
+    return channels;
+}
+
+int Connection::socket() const {
+    return PQsocket(connection);
+}
+
+bool wait_for_notification(std::span<const Connection* const> connections, std::chrono::milliseconds timeout) {
+    std::vector<pollfd> descriptors;
+    descriptors.reserve(connections.size());
+    bool notified{ false };
+    for (const auto connection : connections) {
+        // Notifications may already have been read along with an earlier query result.
+        // Every connection is drained, so that none of them reports the same insert again on the next wait.
+        if (!connection->consume_notifications().empty()) {
+            notified = true;
+        }
+        if (const auto socket = connection->socket(); socket >= 0) {
+            descriptors.push_back({ .fd = socket, .events = POLLIN });
+        }
+    }
+    if (notified) {
+        return true;
+    }
+    if (descriptors.empty()) {
+        return false;
+    }
+    const auto status = poll(descriptors.data(), descriptors.size(), static_cast<int>(timeout.count()));
+    if (status <= 0) {
+        // Timed out, or interrupted by a signal.
+        return false;
+    }
+    for (const auto connection : connections) {
+        if (!connection->consume_notifications().empty()) {
+            notified = true;
+        }
+    }
+    return notified;
+}
+
 }
@@ -2,6 +2,9 @@
 
 #include "QueryResult.hpp"
 
+#include <chrono>
+#include <span>
+
 namespace frog::database {
 
 class Connection {
@@ -23,10 +26,29 @@ public:
     bool has_error() const;
     std::string status_message() const;
 
+    // Reads any input that has arrived without blocking, so that a connection closed by the server is noticed before it is used.
+    // Returns false if the connection is broken.
+    bool is_alive() const;
+
+    // Closes and reopens the connection with the same parameters. Returns false if reconnecting failed.
+    bool reset();
+
+    // Subscribes this connection to notifications sent on the channel with NOTIFY or pg_notify().
+    bool listen(std::string_view channel) const;
+
+    // Reads any notifications that have arrived without blocking. Returns the channel names in order of arrival.
+    std::vector<std::string> consume_notifications() const;
+
+    int socket() const;
+
 private:
 
     PGconn* connection{ nullptr };
 
 };
 
+// Blocks until any of the connections receives a notification, or the timeout expires.
+// Returns true if a notification arrived. Pending notifications are consumed on every connection.
+bool wait_for_notification(std::span<const Connection* const> connections, std::chrono::milliseconds timeout);
+
 }
@@ -0,0 +1,129 @@
+#include "ConnectionPool.hpp"
+#include "Core/Log.hpp"
+
+#include <algorithm>
+
+namespace frog::database {
+
+static constexpr std::chrono::milliseconds initial_retry_delay{ 1000 };
+
+ConnectionLease::ConnectionLease(ConnectionLease&& that) noexcept : pool{ that.pool }, connection{ that.connection } {
+    that.pool = nullptr;
+    that.connection = nullptr;
+}
+
+bool ConnectionLease::reconnect() {
+    if (!pool || !connection) {
+        return false;
+    }
+    std::lock_guard lock{ pool->mutex };
+    return pool->reconnect(*connection);
+}
+
+ConnectionLease::~ConnectionLease() {
+    if (pool && connection) {
+        pool->release(connection);
+    }
+}
+
+ConnectionPool::ConnectionPool(std::string host, int port, std::string databaseName, std::string user, std::string password, std::chrono::seconds maxRetryDelay)
+    : host{ std::move(host) }, port{ port }, databaseName{ std::move(databaseName) }, user{ std::move(user) }, password{ std::move(password) }, maxRetryDelay{ maxRetryDelay } {}
+
+std::optional<ConnectionLease> ConnectionPool::acquire() {
+    std::unique_lock lock{ mutex };
+    while (!idleConnections.empty()) {
+        auto connection = std::move(idleConnections.back());
+        idleConnections.pop_back();
+        if (is_healthy(*connection)) {
+            return ConnectionLease{ *this, connection.release() };
+        }
+        // The broken connection is dropped, and will be replaced below if there are no other idle connections.
+    }
+    if (std::chrono::steady_clock::now() < nextRetryTime) {
+        return std::nullopt;
+    }
+    auto connection = std::make_unique<Connection>(host, port, databaseName, user, password);
+    if (connection->has_error() || !subscribe(*connection)) {
+        on_connection_failed(*connection);
+        return std::nullopt;
+    }
+    currentRetryDelay = {};
+    return ConnectionLease{ *this, connection.release() };
+}
+
+void ConnectionPool::listen(std::string_view channel) {
+    std::lock_guard lock{ mutex };
+    if (std::ranges::find(channels, channel) != channels.end()) {
+        return;
+    }
+    channels.emplace_back(channel);
+    // A connection that fails to listen is reset, which subscribes it to every channel again. If that fails too, it is dropped.
+    std::erase_if(idleConnections, [this, channel](const std::unique_ptr<Connection>& connection) {
+        if (connection->listen(channel)) {
+            return false;
+        }
+        log::warning("Failed to listen on {} in database {}: {}", channel, databaseName, connection->status_message());
+        return !reconnect(*connection);
+    });
+}
+
+std::chrono::milliseconds ConnectionPool::retry_delay() const {
+    std::lock_guard lock{ mutex };
+    const auto now = std::chrono::steady_clock::now();
+    if (now >= nextRetryTime) {
+        return {};
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(nextRetryTime - now);
+}
+
+std::string_view ConnectionPool::name() const {
+    return databaseName;
+}
+
+void ConnectionPool::release(Connection* connection) {
+    std::lock_guard lock{ mutex };
+    idleConnections.emplace_back(connection);
+}
+
+bool ConnectionPool::is_healthy(Connection& connection) {
+    if (connection.is_alive()) {
+        return true;
+    }
+    return reconnect(connection);
+}
+
+bool ConnectionPool::reconnect(Connection& connection) {
+    if (std::chrono::steady_clock::now() < nextRetryTime) {
+        return false;
+    }
+    log::warning("Connection to database {} at {} was lost. Reconnecting.", databaseName, host);
+    if (!connection.reset()) {
+        on_connection_failed(connection);
+        return false;
+    }
+    // Subscriptions do not survive a reset.
+    if (!subscribe(connection)) {
+        on_connection_failed(connection);
+        return false;
+    }
+    currentRetryDelay = {};
+    return true;
+}
+
+bool ConnectionPool::subscribe(Connection& connection) const {
+    for (const auto& channel : channels) {
+        if (!connection.listen(channel)) {
+            log::warning("Failed to listen on {} in database {}: {}", channel, databaseName, connection.status_message());
+            return false;
+        }
+    }
+    return true;
+}
+
+void ConnectionPool::on_connection_failed(const Connection& connection) {
+    currentRetryDelay = std::min<std::chrono::milliseconds>(currentRetryDelay == std::chrono::milliseconds{} ? initial_retry_delay : currentRetryDelay * 2, maxRetryDelay);
+    nextRetryTime = std::chrono::steady_clock::now() + currentRetryDelay;
+    log::warning("Failed to connect to database {} at {}. Retrying in {} ms. Error: {}", databaseName, host, currentRetryDelay.count(), connection.status_message());
+}
+
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Connection.hpp"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace frog::database {
+
+class ConnectionPool;
+
+// Exclusive use of a pooled connection. The connection is returned to the pool when the lease is destroyed.
+class ConnectionLease {
+public:
+
+    ConnectionLease(ConnectionPool& pool, Connection* connection) : pool{ &pool }, connection{ connection } {}
+    ConnectionLease(const ConnectionLease&) = delete;
+    ConnectionLease(ConnectionLease&& that) noexcept;
+
+    ~ConnectionLease();
+
+    ConnectionLease& operator=(const ConnectionLease&) = delete;
+    ConnectionLease& operator=(ConnectionLease&&) = delete;
+
+    Connection& operator*() const {
+        return *connection;
+    }
+
+    Connection* operator->() const {
+        return connection;
+    }
+
+    Connection* get() const {
+        return connection;
+    }
+
+    // Reconnects after a failed query, unless the pool is backing off. Returns false if the connection is still broken.
+    bool reconnect();
+
+private:
+
+    ConnectionPool* pool{ nullptr };
+    Connection* connection{ nullptr };
+
+};
+
+// Long-lived connections to one database. Connections are opened when first needed and kept open between uses.
+// A connection is checked for input from the server when acquired, and a broken one is reset. Failed attempts back off exponentially up to maxRetryDelay.
+class ConnectionPool {
+public:
+
+    ConnectionPool(std::string host, int port, std::string databaseName, std::string user, std::string password, std::chrono::seconds maxRetryDelay);
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool(ConnectionPool&&) = delete;
+
+    ~ConnectionPool() = default;
+
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(ConnectionPool&&) = delete;
+
+    // Returns std::nullopt if no healthy connection could be made, or if we are waiting to retry.
+    std::optional<ConnectionLease> acquire();
+
+    // Every connection in the pool, including ones opened or reset later, will listen on this channel.
+    void listen(std::string_view channel);
+
+    // Time left until the next connection attempt is allowed. Zero if not backing off.
+    std::chrono::milliseconds retry_delay() const;
+
+    std::string_view name() const;
+
+private:
+
+    friend class ConnectionLease;
+
+    void release(Connection* connection);
+    bool is_healthy(Connection& connection);
+    bool reconnect(Connection& connection);
+    bool subscribe(Connection& connection) const; // Listens on every channel. Returns false if any of them failed.
+    void on_connection_failed(const Connection& connection);
+
+    const std::string host;
+    const int port;
+    const std::string databaseName;
+    const std::string user;
+    const std::string password;
+    const std::chrono::seconds maxRetryDelay;
+
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<Connection>> idleConnections;
+    std::vector<std::string> channels;
+    std::chrono::steady_clock::time_point nextRetryTime;
+    std::chrono::milliseconds currentRetryDelay{};
+
+};
+
+}
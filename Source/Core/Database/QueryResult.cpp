@@ -26,6 +26,10 @@ int QueryResult::count() const {
     return PQntuples(result);
 }
 
+int QueryResult::affected_count() const {
+    return from_string<int>(PQcmdTuples(result)).value_or(0);
+}
+
 bool QueryResult::has_error() const {
     switch (PQresultStatus(result)) {
         case PGRES_BAD_RESPONSE:
@@ -18,6 +18,7 @@ public:
 
     QueryResultRow row(int index) const;
     int count() const;
+    int affected_count() const; // Rows affected by insert, update or delete.
     bool has_error() const;
     std::string status_message() const;
 
@@ -5,18 +5,13 @@
 namespace frog {
 
 template<typename DirectoryIterator>
-static std::vector<std::filesystem::path> iterate_entries_in_directory(const std::filesystem::path& path, entry_inclusion inclusion, const std::function<bool(const std::filesystem::path&)>& predicate, std::size_t preallocated) {
-	thread_local std::vector<std::filesystem::path> entries;
-	entries.clear();
-	if (preallocated > entries.capacity()) {
-		entries.reserve(preallocated);
-	}
+static void iterate_entries_in_directory(const std::filesystem::path& path, entry_inclusion inclusion, const std::function<bool(const std::filesystem::path&)>& predicate, const std::function<void(const std::filesystem::path&)>& callback) {
 	std::error_code begin_error;
 	DirectoryIterator entry{ path, std::filesystem::directory_options::skip_permission_denied, begin_error };
 	while (entry != std::filesystem::end(entry)) {
 		const bool skip{ inclusion != entry_inclusion::everything && ((entry->is_directory() && inclusion == entry_inclusion::only_files) || (!entry->is_directory() && inclusion == entry_inclusion::only_directories)) };
 		if (!skip && (!predicate || predicate(*entry))) {
-			entries.push_back(*entry);
+			callback(*entry);
 		}
 		auto entry_backup = entry;
 		std::error_code increment_error;
@@ -33,7 +28,6 @@ static std::vector<std::filesystem::path> iterate_entries_in_directory(const std
 			}
 		}
 	}
-	return entries;
 }
 
 #ifdef WIN32
@@ -56,24 +50,42 @@ std::filesystem::path _workaround_fix_windows_path(std::filesystem::path path) {
 }
 #endif
 
-std::vector<std::filesystem::path> entries_in_directory(std::filesystem::path path, entry_inclusion inclusion, bool recursive, const std::function<bool(const std::filesystem::path&)>& predicate, std::size_t preallocated) {
+void for_each_entry_in_directory(std::filesystem::path path, entry_inclusion inclusion, bool recursive, const std::function<bool(const std::filesystem::path&)>& predicate, const std::function<void(const std::filesystem::path&)>& callback) {
 	if (path.empty()) {
-		return {};
+		return;
 	}
 #ifdef WIN32
 	path = _workaround_fix_windows_path(path);
 #endif
 	if (recursive) {
-		return iterate_entries_in_directory<std::filesystem::recursive_directory_iterator>(path, inclusion, predicate, preallocated);
+		iterate_entries_in_directory<std::filesystem::recursive_directory_iterator>(path, inclusion, predicate, callback);
 	} else {
-		return iterate_entries_in_directory<std::filesystem::directory_iterator>(path, inclusion, predicate, preallocated);
+		iterate_entries_in_directory<std::filesystem::directory_iterator>(path, inclusion, predicate, callback);
 	}
 }
 
-std::vector<std::filesystem::path> files_in_directory(std::filesystem::path path, bool recursive, std::optional<std::string_view> extension, std::size_t preallocated) {
-	return entries_in_directory(path, entry_inclusion::only_files, recursive, extension ? [extension](const std::filesystem::path& path) {
+void for_each_file_in_directory(std::filesystem::path path, bool recursive, std::optional<std::string_view> extension, const std::function<void(const std::filesystem::path&)>& callback) {
+	for_each_entry_in_directory(std::move(path), entry_inclusion::only_files, recursive, extension ? [extension](const std::filesystem::path& path) {
 		return path.extension() == extension.value();
-	} : std::function<bool(const std::filesystem::path&)>{}, preallocated);
+	} : std::function<bool(const std::filesystem::path&)>{}, callback);
+}
+
+std::vector<std::filesystem::path> entries_in_directory(std::filesystem::path path, entry_inclusion inclusion, bool recursive, const std::function<bool(const std::filesystem::path&)>& predicate, std::size_t preallocated) {
+	std::vector<std::filesystem::path> entries;
+	entries.reserve(preallocated);
+	for_each_entry_in_directory(std::move(path), inclusion, recursive, predicate, [&entries](const std::filesystem::path& entry) {
+		entries.push_back(entry);
+	});
+	return entries;
+}
+
+std::vector<std::filesystem::path> files_in_directory(std::filesystem::path path, bool recursive, std::optional<std::string_view> extension, std::size_t preallocated) {
+	std::vector<std::filesystem::path> files;
+	files.reserve(preallocated);
+	for_each_file_in_directory(std::move(path), recursive, extension, [&files](const std::filesystem::path& file) {
+		files.push_back(file);
+	});
+	return files;
 }
 
 bool write_file(const std::filesystem::path& path, std::string_view source) {
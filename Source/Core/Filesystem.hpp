@@ -8,6 +8,9 @@ namespace frog {
 
 enum class entry_inclusion { everything, only_files, only_directories };
 
+// Calls the callback for each entry as the directory is read, so large trees are never held in memory at once.
+void for_each_entry_in_directory(std::filesystem::path path, entry_inclusion inclusion, bool recursive, const std::function<bool(const std::filesystem::path&)>& predicate, const std::function<void(const std::filesystem::path&)>& callback);
+void for_each_file_in_directory(std::filesystem::path path, bool recursive, std::optional<std::string_view> extension, const std::function<void(const std::filesystem::path&)>& callback);
 std::vector<std::filesystem::path> entries_in_directory(std::filesystem::path path, entry_inclusion inclusion, bool recursive, const std::function<bool(const std::filesystem::path&)>& predicate, std::size_t preallocated = 0);
 std::vector<std::filesystem::path> files_in_directory(std::filesystem::path path, bool recursive, std::optional<std::string_view> extension = std::nullopt, std::size_t preallocated = 0);
 bool write_file(const std::filesystem::path& path, std::string_view source);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+namespace frog {
+
+// Limits how many bytes can be reserved at once across threads. Reserving blocks until enough has been released.
+// A reservation larger than the whole budget is let through once nothing else is reserved, so it can never deadlock.
+class MemoryBudget {
+public:
+
+    MemoryBudget(std::size_t limit) : limit{ limit } {}
+    MemoryBudget(const MemoryBudget&) = delete;
+    MemoryBudget(MemoryBudget&&) = delete;
+
+    ~MemoryBudget() = default;
+
+    MemoryBudget& operator=(const MemoryBudget&) = delete;
+    MemoryBudget& operator=(MemoryBudget&&) = delete;
+
+    void reserve(std::size_t size) {
+        std::unique_lock lock{ mutex };
+        released.wait(lock, [this, size] {
+            return reserved == 0 || reserved + size <= limit;
+        });
+        reserved += size;
+    }
+
+    void release(std::size_t size) {
+        {
+            std::lock_guard lock{ mutex };
+            reserved -= std::min(size, reserved);
+        }
+        released.notify_all();
+    }
+
+    [[nodiscard]] std::size_t getReserved() const {
+        std::lock_guard lock{ mutex };
+        return reserved;
+    }
+
+private:
+
+    mutable std::mutex mutex;
+    std::condition_variable released;
+    const std::size_t limit;
+    std::size_t reserved{};
+
+};
+
+}
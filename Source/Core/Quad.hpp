@@ -1,9 +1,37 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
 
 namespace frog {
 
+// Axis-aligned bounds of a quad.
+struct QuadBounds {
+    float left{};
+    float top{};
+    float right{};
+    float bottom{};
+
+    float area() const {
+        return (right - left) * (bottom - top);
+    }
+
+    float intersectionArea(const QuadBounds& that) const {
+        const auto width = std::max(std::min(right, that.right) - std::max(left, that.left), 0.0f);
+        const auto height = std::max(std::min(bottom, that.bottom) - std::max(top, that.top), 0.0f);
+        return width * height;
+    }
+
+    // How much of this is covered by that, from 0 to 1.
+    float coverage(const QuadBounds& that) const {
+        return intersectionArea(that) / area();
+    }
+
+    bool overlaps(const QuadBounds& that) const {
+        return left <= that.right && that.left <= right && top <= that.bottom && that.top <= bottom;
+    }
+};
+
 struct Quad {
     float x1{};
     float y1{};
@@ -46,16 +74,13 @@ struct Quad {
         return width() * height();
     }
 
+    QuadBounds bounds() const {
+        return { left(), top(), right(), bottom() };
+    }
+
+    // How much of this is covered by that, from 0 to 1.
     float coverage(const Quad& that) const {
-        const auto x = that.left();
-        const auto y = that.top();
-        const auto w = that.width();
-        const auto h = that.height();
-        const auto ix = std::max(x, left());
-        const auto iy = std::max(y, top());
-        const auto iw = std::min(x + w, right()) - ix;
-        const auto ih = std::min(y + h, bottom()) - iy;
-        return (iw * ih) / area();
+        return bounds().coverage(that.bounds());
     }
 
     bool contains(float x, float y) const {
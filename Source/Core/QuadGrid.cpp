@@ -0,0 +1,77 @@
+#include "Core/QuadGrid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace frog {
+
+QuadGrid::QuadGrid(const std::vector<Quad>& quads) {
+    if (quads.empty()) {
+        return;
+    }
+    std::vector<QuadBounds> bounds;
+    bounds.reserve(quads.size());
+    gridBounds = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+    float totalSize{};
+    for (const auto& quad : quads) {
+        const auto& quadBounds = bounds.emplace_back(quad.bounds());
+        gridBounds.left = std::min(gridBounds.left, quadBounds.left);
+        gridBounds.top = std::min(gridBounds.top, quadBounds.top);
+        gridBounds.right = std::max(gridBounds.right, quadBounds.right);
+        gridBounds.bottom = std::max(gridBounds.bottom, quadBounds.bottom);
+        totalSize += std::max(quadBounds.right - quadBounds.left, quadBounds.bottom - quadBounds.top);
+    }
+
+    // Cells about the size of an average quad, but no more than a few per quad.
+    cellSize = std::max(totalSize / static_cast<float>(quads.size()), 1.0f);
+    const auto gridWidth = gridBounds.right - gridBounds.left;
+    const auto gridHeight = gridBounds.bottom - gridBounds.top;
+    const auto maxCellCount = static_cast<float>(quads.size()) * 4.0f + 16.0f;
+    if ((gridWidth / cellSize + 1.0f) * (gridHeight / cellSize + 1.0f) > maxCellCount) {
+        cellSize = std::max(cellSize, std::sqrt(gridWidth * gridHeight / maxCellCount) + 1.0f);
+    }
+    columnCount = static_cast<int>(gridWidth / cellSize) + 1;
+    rowCount = static_cast<int>(gridHeight / cellSize) + 1;
+
+    // Count the entries of each cell, turn the counts into offsets, and then place the quads.
+    const auto cellCount = static_cast<std::size_t>(columnCount * rowCount);
+    cellStarts.assign(cellCount + 1, 0);
+    const auto forEachQuadCell = [this](const QuadBounds& quadBounds, auto&& callback) {
+        const auto firstCell = getCell(quadBounds.left, quadBounds.top);
+        const auto lastCell = getCell(quadBounds.right, quadBounds.bottom);
+        for (int row{ firstCell.row }; row <= lastCell.row; row++) {
+            for (int column{ firstCell.column }; column <= lastCell.column; column++) {
+                callback(static_cast<std::size_t>(row * columnCount + column));
+            }
+        }
+    };
+    for (const auto& quadBounds : bounds) {
+        forEachQuadCell(quadBounds, [this](std::size_t cell) {
+            cellStarts[cell + 1]++;
+        });
+    }
+    for (std::size_t cell{ 0 }; cell < cellCount; cell++) {
+        cellStarts[cell + 1] += cellStarts[cell];
+    }
+    std::vector<std::uint32_t> entries(cellStarts.back());
+    auto nextEntries = cellStarts;
+    for (std::size_t index{ 0 }; index < bounds.size(); index++) {
+        forEachQuadCell(bounds[index], [&entries, &nextEntries, index](std::size_t cell) {
+            entries[nextEntries[cell]++] = static_cast<std::uint32_t>(index);
+        });
+    }
+    cellQuads.reserve(entries.size());
+    for (const auto index : entries) {
+        cellQuads.push_back(bounds[index]);
+    }
+    cellEntries = std::move(entries);
+}
+
+QuadGrid::Cell QuadGrid::getCell(float x, float y) const {
+    const auto column = static_cast<int>((x - gridBounds.left) / cellSize);
+    const auto row = static_cast<int>((y - gridBounds.top) / cellSize);
+    return { std::clamp(column, 0, columnCount - 1), std::clamp(row, 0, rowCount - 1) };
+}
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Core/QuadSet.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace frog {
+
+// Uniform grid over the axis-aligned bounds of a set of quads, for finding the quads that may overlap an area
+// without comparing against all of them. The cell size follows the average quad size, and the number of cells
+// is kept in proportion to the number of quads, so both building and querying stay close to linear.
+class QuadGrid {
+public:
+
+    QuadGrid(const std::vector<Quad>& quads);
+
+    // Calls callback(index) once for each quad whose bounds overlap the bounds of the given quad.
+    template<typename Callback>
+    void forEachOverlapping(const Quad& quad, Callback&& callback) const {
+        forEachCell(quad.bounds(), [&](const QuadBounds& query, std::size_t begin, std::size_t end, const Cell& queryCell, const Cell& cell) {
+            for (auto entry = begin; entry < end; entry++) {
+                if (cellQuads.bounds(entry).overlaps(query) && isFirstSharedCell(entry, queryCell, cell)) {
+                    callback(static_cast<std::size_t>(cellEntries[entry]));
+                }
+            }
+        });
+    }
+
+    // Calls callback(index) once for each quad that covers more than minCoverage of the given quad, or the other way around.
+    template<typename Callback>
+    void forEachCovering(const Quad& quad, float minCoverage, Callback&& callback) const {
+        forEachCell(quad.bounds(), [&](const QuadBounds& query, std::size_t begin, std::size_t end, const Cell& queryCell, const Cell& cell) {
+            const auto queryArea = query.area();
+            float intersectionAreas[batchSize];
+            for (auto batchBegin = begin; batchBegin < end; batchBegin += batchSize) {
+                const auto batchEnd = std::min(batchBegin + batchSize, end);
+                cellQuads.intersectionAreas(query, batchBegin, batchEnd, intersectionAreas);
+                for (auto entry = batchBegin; entry < batchEnd; entry++) {
+                    const auto intersectionArea = intersectionAreas[entry - batchBegin];
+                    const auto covering = intersectionArea / cellQuads.area(entry) > minCoverage || intersectionArea / queryArea > minCoverage;
+                    if (covering && isFirstSharedCell(entry, queryCell, cell)) {
+                        callback(static_cast<std::size_t>(cellEntries[entry]));
+                    }
+                }
+            }
+        });
+    }
+
+private:
+
+    static constexpr std::size_t batchSize{ 64 };
+
+    struct Cell {
+        int column{};
+        int row{};
+    };
+
+    [[nodiscard]] Cell getCell(float x, float y) const;
+
+    // Calls callback(query, begin, end, queryCell, cell) with the range of cellQuads in each cell the bounds overlap.
+    // queryCell is the first cell of the query.
+    template<typename Callback>
+    void forEachCell(const QuadBounds& query, Callback&& callback) const {
+        if (cellQuads.empty() || !query.overlaps(gridBounds)) {
+            return;
+        }
+        const auto queryCell = getCell(query.left, query.top);
+        const auto lastQueryCell = getCell(query.right, query.bottom);
+        for (int row{ queryCell.row }; row <= lastQueryCell.row; row++) {
+            for (int column{ queryCell.column }; column <= lastQueryCell.column; column++) {
+                const auto cellIndex = static_cast<std::size_t>(row * columnCount + column);
+                callback(query, cellStarts[cellIndex], cellStarts[cellIndex + 1], queryCell, Cell{ column, row });
+            }
+        }
+    }
+
+    // A quad spanning several cells is only reported from the first cell it shares with the query.
+    [[nodiscard]] bool isFirstSharedCell(std::size_t entry, const Cell& queryCell, const Cell& cell) const {
+        const auto bounds = cellQuads.bounds(entry);
+        const auto firstCell = getCell(bounds.left, bounds.top);
+        return cell.column == std::max(firstCell.column, queryCell.column) && cell.row == std::max(firstCell.row, queryCell.row);
+    }
+
+    QuadSet cellQuads; // Bounds of the quads, grouped by cell. A quad spanning several cells is in each of them.
+    std::vector<std::uint32_t> cellStarts; // Offsets into cellQuads, with one extra at the end.
+    std::vector<std::uint32_t> cellEntries; // Index of the original quad for each of cellQuads.
+    QuadBounds gridBounds;
+    float cellSize{ 1.0f };
+    int columnCount{};
+    int rowCount{};
+
+};
+
+}
@@ -0,0 +1,31 @@
+#include "Core/QuadSet.hpp"
+
+namespace frog {
+
+void QuadSet::reserve(std::size_t capacity) {
+    for (auto* values : { &lefts, &tops, &rights, &bottoms, &areas }) {
+        values->reserve(capacity);
+    }
+}
+
+void QuadSet::push_back(const QuadBounds& bounds) {
+    lefts.push_back(bounds.left);
+    tops.push_back(bounds.top);
+    rights.push_back(bounds.right);
+    bottoms.push_back(bounds.bottom);
+    areas.push_back(bounds.area());
+}
+
+void QuadSet::intersectionAreas(const QuadBounds& bounds, std::size_t begin, std::size_t end, float* result) const {
+    const auto* left = lefts.data();
+    const auto* top = tops.data();
+    const auto* right = rights.data();
+    const auto* bottom = bottoms.data();
+    for (auto i = begin; i < end; i++) {
+        const auto width = std::max(std::min(right[i], bounds.right) - std::max(left[i], bounds.left), 0.0f);
+        const auto height = std::max(std::min(bottom[i], bounds.bottom) - std::max(top[i], bounds.top), 0.0f);
+        result[i - begin] = width * height;
+    }
+}
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Core/Quad.hpp"
+
+#include <vector>
+
+namespace frog {
+
+// The axis-aligned bounds of a set of quads, stored as one array per side together with their areas.
+// The batch function compares bounds against a range of the set, and writes one result per quad.
+// It is a plain loop over contiguous arrays without branches, so that the compiler can vectorize it.
+class QuadSet {
+public:
+
+    void reserve(std::size_t capacity);
+    void push_back(const QuadBounds& bounds);
+
+    [[nodiscard]] std::size_t size() const {
+        return lefts.size();
+    }
+
+    [[nodiscard]] bool empty() const {
+        return lefts.empty();
+    }
+
+    [[nodiscard]] QuadBounds bounds(std::size_t index) const {
+        return { lefts[index], tops[index], rights[index], bottoms[index] };
+    }
+
+    [[nodiscard]] float area(std::size_t index) const {
+        return areas[index];
+    }
+
+    // The intersection area of each quad in [begin, end) with the bounds.
+    void intersectionAreas(const QuadBounds& bounds, std::size_t begin, std::size_t end, float* result) const;
+
+private:
+
+    std::vector<float> lefts;
+    std::vector<float> tops;
+    std::vector<float> rights;
+    std::vector<float> bottoms;
+    std::vector<float> areas;
+
+};
+
+}
@@ -1,28 +1,66 @@
 #include "Core/SambaClient.hpp"
 #include "Core/Log.hpp"
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 namespace frog {
 
-static std::unique_ptr<SambaClient> globalSambaClient;
-static std::mutex sambaMutex;
+struct SambaClientPool {
+    std::vector<SambaCredentialsConfig> configs;
+    std::size_t maxClientCount{};
+    std::vector<std::unique_ptr<SambaClient>> clients;
+    std::vector<SambaClient*> idleClients;
+    std::size_t startingClientCount{}; // Clients being created outside the lock.
+    std::mutex mutex;
+    std::condition_variable clientReleased;
+};
+
+static std::unique_ptr<SambaClientPool> globalSambaClientPool;
 
-void initialize_samba_client(std::vector<SambaCredentialsConfig> configs) {
+void initialize_samba_client(std::vector<SambaCredentialsConfig> configs, int clientCount) {
     if (configs.empty()) {
         return;
     }
-    globalSambaClient = std::make_unique<SambaClient>(std::move(configs));
+    globalSambaClientPool = std::make_unique<SambaClientPool>();
+    globalSambaClientPool->configs = std::move(configs);
+    globalSambaClientPool->maxClientCount = static_cast<std::size_t>(std::max(clientCount, 1));
 }
 
 SambaClient* acquire_samba_client() {
-    if (!globalSambaClient) {
+    if (!globalSambaClientPool) {
         return nullptr;
     }
-    sambaMutex.lock();
-    return globalSambaClient.get();
+    auto& pool = *globalSambaClientPool;
+    std::unique_lock lock{ pool.mutex };
+    pool.clientReleased.wait(lock, [&pool] {
+        return !pool.idleClients.empty() || pool.clients.size() + pool.startingClientCount < pool.maxClientCount;
+    });
+    if (!pool.idleClients.empty()) {
+        auto client = pool.idleClients.back();
+        pool.idleClients.pop_back();
+        return client;
+    }
+    // Creating a client connects to the network, so other threads may take or return clients meanwhile.
+    pool.startingClientCount++;
+    lock.unlock();
+    auto client = std::make_unique<SambaClient>(pool.configs);
+    lock.lock();
+    pool.startingClientCount--;
+    return pool.clients.emplace_back(std::move(client)).get();
 }
 
-void release_samba_client() {
-    sambaMutex.unlock();
+void release_samba_client(SambaClient* client) {
+    if (!client || !globalSambaClientPool) {
+        return;
+    }
+    auto& pool = *globalSambaClientPool;
+    {
+        std::lock_guard lock{ pool.mutex };
+        pool.idleClients.push_back(client);
+    }
+    pool.clientReleased.notify_one();
 }
 
 static std::optional<DirectoryEntryFileType> getDirectoryEntryFileTypeFromType(unsigned int type) {
@@ -69,6 +107,10 @@ void get_samba_context_auth_data_callback(SMBCCTX* context, const char* server,
 }
 
 SambaClient::SambaClient(std::vector<SambaCredentialsConfig> configs_) : configs{ std::move(configs_) } {
+    // libsmbclient keeps process-wide state even with separate contexts, and it is only safe to share between threads
+    // once it has been told to use pthread locks.
+    static std::once_flag threadSupportInitialized;
+    std::call_once(threadSupportInitialized, smbc_thread_posix);
     context = smbc_new_context();
     if (!context) {
         fmt::print("Failed to create new samba client context.\n");
@@ -258,33 +300,51 @@ std::optional<DirectoryEntryFileType> SambaClient::getFileType(const std::string
     return getDirectoryEntryFileTypeFromMode(result.st_mode);
 }
 
-std::vector<std::string> SambaClient::getDirectoryFiles(const std::string& path, bool recursive) {
+bool SambaClient::forEachDirectoryEntry(const std::string& path, const std::function<void(const std::string&, DirectoryEntryFileType)>& callback) {
     const auto directory = sambaOpenDir(context, path.c_str());
     if (!directory) {
         fmt::print("Failed to open directory: {}.\n", path);
-        return {};
+        return false;
     }
-    std::vector<std::string> files;
     while (true) {
         const auto entry = sambaReadDir(context, directory);
         if (!entry) {
             break;
         }
-        std::string name{ entry->name };
+        const std::string_view name{ entry->name };
         if (name == "." || name == ".." || name.empty()) {
             continue;
         }
-        const auto type = getDirectoryEntryFileTypeFromType(entry->smbc_type);
-        if (type == DirectoryEntryFileType::directory && recursive) {
-            auto subFiles = getDirectoryFiles(fmt::format("{}/{}", path, name), true);
-            files.insert(files.end(), subFiles.begin(), subFiles.end());
-        } else if (type == DirectoryEntryFileType::file) {
-            files.emplace_back(fmt::format("{}/{}", path, name));
+        if (const auto type = getDirectoryEntryFileTypeFromType(entry->smbc_type)) {
+            callback(fmt::format("{}/{}", path, name), type.value());
         }
     }
     if (sambaCloseDir(context, directory) < 0) {
         fmt::print("Failed closing directory. Error: {}\n", errno);
     }
+    return true;
+}
+
+void SambaClient::forEachDirectoryFile(const std::string& path, bool recursive, const std::function<void(const std::string&)>& callback) {
+    std::vector<std::string> pendingDirectories{ path };
+    while (!pendingDirectories.empty()) {
+        const auto directory = std::move(pendingDirectories.back());
+        pendingDirectories.pop_back();
+        forEachDirectoryEntry(directory, [&](const std::string& entryPath, DirectoryEntryFileType type) {
+            if (type == DirectoryEntryFileType::directory && recursive) {
+                pendingDirectories.push_back(entryPath);
+            } else if (type == DirectoryEntryFileType::file) {
+                callback(entryPath);
+            }
+        });
+    }
+}
+
+std::vector<std::string> SambaClient::getDirectoryFiles(const std::string& path, bool recursive) {
+    std::vector<std::string> files;
+    forEachDirectoryFile(path, recursive, [&files](const std::string& file) {
+        files.push_back(file);
+    });
     return files;
 }
 
@@ -312,4 +372,65 @@ bool SambaClient::createDirectories(const std::string& path) {
     return true;
 }
 
+void for_each_samba_directory_file(const std::string& path, int directoriesInFlight, const std::function<void(const std::string&)>& callback) {
+    std::mutex mutex;
+    std::condition_variable pendingChanged;
+    std::vector<std::string> pendingDirectories{ path };
+    int activeWalkerCount{};
+    std::mutex callbackMutex;
+
+    const auto walk = [&] {
+        std::unique_lock lock{ mutex };
+        while (true) {
+            pendingChanged.wait(lock, [&] {
+                return !pendingDirectories.empty() || activeWalkerCount == 0;
+            });
+            if (pendingDirectories.empty()) {
+                // Nothing left to list, and no other walker can discover more directories.
+                return;
+            }
+            const auto directory = std::move(pendingDirectories.back());
+            pendingDirectories.pop_back();
+            activeWalkerCount++;
+            lock.unlock();
+
+            std::vector<std::string> subdirectories;
+            std::vector<std::string> files;
+            auto sambaClient = acquire_samba_client();
+            if (sambaClient) {
+                sambaClient->forEachDirectoryEntry(directory, [&](const std::string& entryPath, DirectoryEntryFileType type) {
+                    if (type == DirectoryEntryFileType::directory) {
+                        subdirectories.push_back(entryPath);
+                    } else if (type == DirectoryEntryFileType::file) {
+                        files.push_back(entryPath);
+                    }
+                });
+                release_samba_client(sambaClient);
+            }
+            {
+                std::lock_guard callbackLock{ callbackMutex };
+                for (const auto& file : files) {
+                    callback(file);
+                }
+            }
+
+            lock.lock();
+            for (auto& subdirectory : subdirectories) {
+                pendingDirectories.push_back(std::move(subdirectory));
+            }
+            activeWalkerCount--;
+            pendingChanged.notify_all();
+        }
+    };
+
+    std::vector<std::thread> walkers;
+    for (int i{ 1 }; i < directoriesInFlight; i++) {
+        walkers.emplace_back(walk);
+    }
+    walk();
+    for (auto& walker : walkers) {
+        walker.join();
+    }
+}
+
 }
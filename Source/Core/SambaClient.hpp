@@ -3,6 +3,7 @@
 #include "Config.hpp"
 
 #include <filesystem>
+#include <functional>
 #include <optional>
 
 #include <samba-4.0/libsmbclient.h>
@@ -33,6 +34,12 @@ public:
     std::optional<DirectoryEntryFileType> getFileType(const std::string& path);
     std::vector<std::string> getDirectoryFiles(const std::string& path, bool recursive);
 
+    // Calls the callback for each file as directories are read, instead of collecting every path first.
+    void forEachDirectoryFile(const std::string& path, bool recursive, const std::function<void(const std::string&)>& callback);
+
+    // Lists the immediate entries of a directory. Returns false if the directory could not be opened.
+    bool forEachDirectoryEntry(const std::string& path, const std::function<void(const std::string&, DirectoryEntryFileType)>& callback);
+
     const std::vector<SambaCredentialsConfig>& getConfigs() const;
 
 private:
@@ -55,8 +62,19 @@ private:
 
 };
 
-void initialize_samba_client(std::vector<SambaCredentialsConfig> configs);
+// Sets up a pool of up to clientCount independent clients, each with its own Samba context.
+// Clients are created when first needed, so idle pool slots do not hold connections.
+void initialize_samba_client(std::vector<SambaCredentialsConfig> configs, int clientCount);
+
+// Checks out a client for exclusive use by the calling thread, and blocks if all clients are checked out.
+// Returns nullptr if Samba has not been configured.
 SambaClient* acquire_samba_client();
-void release_samba_client();
+
+// Returns a client to the pool. Passing nullptr does nothing.
+void release_samba_client(SambaClient* client);
+
+// Recursively walks a share with up to directoriesInFlight directories being listed at once, each with a pooled client.
+// The callback is never called concurrently, but may be called from any of the walking threads.
+void for_each_samba_directory_file(const std::string& path, int directoriesInFlight, const std::function<void(const std::string&)>& callback);
 
 }
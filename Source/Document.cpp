@@ -0,0 +1,200 @@
+#include "Document.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace frog {
+
+// Appends a child to the last parent. The children of a parent stay next to each other, since only the last parent grows.
+template<typename Parent, typename Child>
+static Child& add_child(std::vector<Parent>& parents, ChildRange Parent::* range, std::vector<Child>& children, NodeIndex Child::* parent) {
+    auto& parentRange = parents.back().*range;
+    if (parentRange.count == 0) {
+        parentRange.first = static_cast<NodeIndex>(children.size());
+    }
+    parentRange.count++;
+    auto& child = children.emplace_back();
+    child.*parent = static_cast<NodeIndex>(parents.size() - 1);
+    return child;
+}
+
+Block& Document::addBlock() {
+    return blockNodes.emplace_back();
+}
+
+Paragraph& Document::addParagraph() {
+    return add_child(blockNodes, &Block::paragraphs, paragraphNodes, &Paragraph::block);
+}
+
+Line& Document::addLine() {
+    return add_child(paragraphNodes, &Paragraph::lines, lineNodes, &Line::paragraph);
+}
+
+Word& Document::addWord() {
+    return add_child(lineNodes, &Line::words, wordNodes, &Word::line);
+}
+
+Symbol& Document::addSymbol() {
+    return add_child(wordNodes, &Word::symbols, symbolNodes, &Symbol::word);
+}
+
+Variant& Document::addVariant() {
+    return add_child(symbolNodes, &Symbol::variants, variantNodes, &Variant::symbol);
+}
+
+void Document::removeLastWord() {
+    const auto& word = wordNodes.back();
+    // Its symbols and variants were added after it, so they are the last ones.
+    if (word.symbols.count > 0) {
+        while (!variantNodes.empty() && variantNodes.back().symbol >= word.symbols.first) {
+            variantNodes.pop_back();
+        }
+        symbolNodes.resize(word.symbols.first);
+    }
+    lineNodes[word.line].words.count--;
+    wordNodes.pop_back();
+}
+
+TextRef Document::addText(std::string_view text) {
+    const TextRef ref{ static_cast<std::uint32_t>(texts.size()), static_cast<std::uint32_t>(text.size()) };
+    texts.append(text);
+    return ref;
+}
+
+void Document::merge(Document&& that) {
+    std::vector<int> styleRefsMap;
+    styleRefsMap.reserve(that.fonts.size());
+    for (auto& font : that.fonts) {
+        const auto it = std::ranges::find_if(fonts, [&font](const Font& existingFont) {
+            return existingFont.name == font.name && existingFont.size == font.size;
+        });
+        styleRefsMap.push_back(static_cast<int>(it - fonts.begin()));
+        if (it == fonts.end()) {
+            fonts.push_back(std::move(font));
+        }
+    }
+    const auto mapStyleRefs = [&styleRefsMap](std::optional<int>& styleRefs) {
+        if (styleRefs.has_value() && styleRefs.value() >= 0 && styleRefs.value() < static_cast<int>(styleRefsMap.size())) {
+            styleRefs = styleRefsMap[static_cast<std::size_t>(styleRefs.value())];
+        }
+    };
+
+    // The nodes keep their order, so only the indices and text offsets need to be moved along.
+    const auto textOffset = static_cast<std::uint32_t>(texts.size());
+    const auto blockOffset = static_cast<NodeIndex>(blockNodes.size());
+    const auto paragraphOffset = static_cast<NodeIndex>(paragraphNodes.size());
+    const auto lineOffset = static_cast<NodeIndex>(lineNodes.size());
+    const auto wordOffset = static_cast<NodeIndex>(wordNodes.size());
+    const auto symbolOffset = static_cast<NodeIndex>(symbolNodes.size());
+    texts.append(that.texts);
+    for (auto& block : that.blockNodes) {
+        block.detector.offset += textOffset;
+        block.recognizer.offset += textOffset;
+        block.paragraphs.first += paragraphOffset;
+    }
+    for (auto& paragraph : that.paragraphNodes) {
+        paragraph.block += blockOffset;
+        paragraph.lines.first += lineOffset;
+    }
+    for (auto& line : that.lineNodes) {
+        mapStyleRefs(line.styleRefs);
+        line.paragraph += paragraphOffset;
+        line.words.first += wordOffset;
+    }
+    for (auto& word : that.wordNodes) {
+        mapStyleRefs(word.styleRefs);
+        word.text.offset += textOffset;
+        word.line += lineOffset;
+        word.symbols.first += symbolOffset;
+    }
+    for (auto& symbol : that.symbolNodes) {
+        symbol.text.offset += textOffset;
+        symbol.word += wordOffset;
+        symbol.variants.first += static_cast<NodeIndex>(variantNodes.size());
+    }
+    for (auto& variant : that.variantNodes) {
+        variant.text.offset += textOffset;
+        variant.symbol += symbolOffset;
+    }
+    blockNodes.insert(blockNodes.end(), that.blockNodes.begin(), that.blockNodes.end());
+    paragraphNodes.insert(paragraphNodes.end(), that.paragraphNodes.begin(), that.paragraphNodes.end());
+    lineNodes.insert(lineNodes.end(), std::make_move_iterator(that.lineNodes.begin()), std::make_move_iterator(that.lineNodes.end()));
+    wordNodes.insert(wordNodes.end(), std::make_move_iterator(that.wordNodes.begin()), std::make_move_iterator(that.wordNodes.end()));
+    symbolNodes.insert(symbolNodes.end(), that.symbolNodes.begin(), that.symbolNodes.end());
+    variantNodes.insert(variantNodes.end(), that.variantNodes.begin(), that.variantNodes.end());
+    confidence = { (confidence.getNormalized() + that.confidence.getNormalized()) / 2.0f, Confidence::Format::normalized };
+}
+
+void Document::removeWords(const std::vector<char>& removedWords) {
+    // Rebuilt in reading order, so that the children of each node stay next to each other.
+    // A parent is only kept once it has a child, so the parent index given to its children is the one it gets.
+    std::vector<Block> keptBlocks;
+    std::vector<Paragraph> keptParagraphs;
+    std::vector<Line> keptLines;
+    std::vector<Word> keptWords;
+    std::vector<Symbol> keptSymbols;
+    std::vector<Variant> keptVariants;
+    keptBlocks.reserve(blockNodes.size());
+    keptParagraphs.reserve(paragraphNodes.size());
+    keptLines.reserve(lineNodes.size());
+    keptWords.reserve(wordNodes.size());
+    keptSymbols.reserve(symbolNodes.size());
+    keptVariants.reserve(variantNodes.size());
+    for (auto block : blockNodes) {
+        const auto oldParagraphs = block.paragraphs;
+        block.paragraphs = { static_cast<NodeIndex>(keptParagraphs.size()), 0 };
+        for (auto paragraphIndex = oldParagraphs.first; paragraphIndex < oldParagraphs.first + oldParagraphs.count; paragraphIndex++) {
+            auto paragraph = paragraphNodes[paragraphIndex];
+            const auto oldLines = paragraph.lines;
+            paragraph.block = static_cast<NodeIndex>(keptBlocks.size());
+            paragraph.lines = { static_cast<NodeIndex>(keptLines.size()), 0 };
+            for (auto lineIndex = oldLines.first; lineIndex < oldLines.first + oldLines.count; lineIndex++) {
+                auto line = lineNodes[lineIndex];
+                const auto oldWords = line.words;
+                line.paragraph = static_cast<NodeIndex>(keptParagraphs.size());
+                line.words = { static_cast<NodeIndex>(keptWords.size()), 0 };
+                for (auto wordIndex = oldWords.first; wordIndex < oldWords.first + oldWords.count; wordIndex++) {
+                    if (removedWords[wordIndex]) {
+                        continue;
+                    }
+                    auto word = wordNodes[wordIndex];
+                    const auto oldSymbols = word.symbols;
+                    word.line = static_cast<NodeIndex>(keptLines.size());
+                    word.symbols = { static_cast<NodeIndex>(keptSymbols.size()), oldSymbols.count };
+                    for (auto symbolIndex = oldSymbols.first; symbolIndex < oldSymbols.first + oldSymbols.count; symbolIndex++) {
+                        auto symbol = symbolNodes[symbolIndex];
+                        const auto oldVariants = symbol.variants;
+                        symbol.word = static_cast<NodeIndex>(keptWords.size());
+                        symbol.variants = { static_cast<NodeIndex>(keptVariants.size()), oldVariants.count };
+                        for (auto variantIndex = oldVariants.first; variantIndex < oldVariants.first + oldVariants.count; variantIndex++) {
+                            auto& variant = keptVariants.emplace_back(variantNodes[variantIndex]);
+                            variant.symbol = static_cast<NodeIndex>(keptSymbols.size());
+                        }
+                        keptSymbols.push_back(symbol);
+                    }
+                    keptWords.push_back(std::move(word));
+                    line.words.count++;
+                }
+                if (line.words.count > 0) {
+                    keptLines.push_back(std::move(line));
+                    paragraph.lines.count++;
+                }
+            }
+            if (paragraph.lines.count > 0) {
+                keptParagraphs.push_back(paragraph);
+                block.paragraphs.count++;
+            }
+        }
+        if (block.paragraphs.count > 0) {
+            keptBlocks.push_back(block);
+        }
+    }
+    blockNodes = std::move(keptBlocks);
+    paragraphNodes = std::move(keptParagraphs);
+    lineNodes = std::move(keptLines);
+    wordNodes = std::move(keptWords);
+    symbolNodes = std::move(keptSymbols);
+    variantNodes = std::move(keptVariants);
+}
+
+}
@@ -4,19 +4,39 @@
 #include "Core/Log.hpp"
 #include "Core/Quad.hpp"
 
+#include <cstdint>
 #include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace frog {
 
+using NodeIndex = std::uint32_t;
+
+// Text stored in the string pool of a document.
+struct TextRef {
+    std::uint32_t offset{};
+    std::uint32_t size{};
+};
+
+// The children of a node, which are always next to each other in the level below.
+struct ChildRange {
+    NodeIndex first{};
+    NodeIndex count{};
+};
+
 struct Font {
     std::string name;
     int size{};
 };
 
 struct Variant {
-    std::string text;
+    TextRef text;
     Confidence confidence;
+    NodeIndex symbol{};
 };
 
 struct Symbol {
@@ -24,9 +44,10 @@ struct Symbol {
     int y{};
     int width{};
     int height{};
-    std::string text;
+    TextRef text;
     Confidence confidence;
-    std::vector<Variant> variants;
+    NodeIndex word{};
+    ChildRange variants;
 };
 
 struct Word {
@@ -35,10 +56,11 @@ struct Word {
     int width{};
     int height{};
     float angleInDegrees{};
-    std::vector<Symbol> symbols;
-    std::string text;
+    TextRef text;
     Confidence confidence;
     std::optional<int> styleRefs;
+    NodeIndex line{};
+    ChildRange symbols;
 };
 
 inline Quad make_word_quad(const Word& word) {
@@ -50,9 +72,10 @@ struct Line {
     int y{};
     int width{};
     int height{};
-    std::vector<Word> words;
     Confidence confidence;
     std::optional<int> styleRefs;
+    NodeIndex paragraph{};
+    ChildRange words;
 };
 
 struct Paragraph {
@@ -61,8 +84,9 @@ struct Paragraph {
     int width{};
     int height{};
     float angleInDegrees{};
-    std::vector<Line> lines;
     Confidence confidence;
+    NodeIndex block{};
+    ChildRange lines;
 };
 
 struct Block {
@@ -70,19 +94,27 @@ struct Block {
     int y{};
     int width{};
     int height{};
-    std::vector<Paragraph> paragraphs;
     Confidence confidence;
-    std::string detector;
-    std::string recognizer;
+    TextRef detector;
+    TextRef recognizer;
+    ChildRange paragraphs;
 };
 
-struct Document {
+// The recognized text of a page. Each level is stored in one flat array, in reading order, and nodes refer to their
+// parent and children by index. All text is kept in one string pool. A page therefore takes a handful of allocations
+// however many words it has, and all of it is freed with the document.
+//
+// Nodes are added depth first: a paragraph belongs to the last block added, a line to the last paragraph, and so on.
+// References returned by the add functions and spans of nodes are invalidated when nodes are added to the same level,
+// and string views from text() when text is added.
+class Document {
+public:
+
     std::string language;
     int physicalImageNumber{};
     float rotationInDegrees{};
 
     std::vector<Font> fonts;
-    std::vector<Block> blocks;
     Confidence confidence;
 
     Document() = default;
@@ -92,14 +124,85 @@ struct Document {
     Document& operator=(Document&&) = default;
     Document& operator=(const Document&) = delete;
 
-    void merge(const Document& that) {
-        // TODO: Handle fonts.
-        for (const auto& block : that.blocks) {
-            blocks.push_back(block);
+    Block& addBlock();
+    Paragraph& addParagraph();
+    Line& addLine();
+    Word& addWord();
+    Symbol& addSymbol();
+    Variant& addVariant();
+
+    // Removes the last word added, along with its symbols and variants.
+    void removeLastWord();
+
+    TextRef addText(std::string_view text);
+
+    [[nodiscard]] std::string_view text(TextRef ref) const {
+        return { texts.data() + ref.offset, ref.size };
+    }
+
+    [[nodiscard]] std::span<Block> blocks() {
+        return blockNodes;
+    }
+
+    [[nodiscard]] std::span<const Block> blocks() const {
+        return blockNodes;
+    }
+
+    [[nodiscard]] std::span<const Paragraph> paragraphs(const Block& block) const {
+        return children(paragraphNodes, block.paragraphs);
+    }
+
+    [[nodiscard]] std::span<const Line> lines(const Paragraph& paragraph) const {
+        return children(lineNodes, paragraph.lines);
+    }
+
+    [[nodiscard]] std::span<const Word> words(const Line& line) const {
+        return children(wordNodes, line.words);
+    }
+
+    [[nodiscard]] std::span<const Symbol> symbols(const Word& word) const {
+        return children(symbolNodes, word.symbols);
+    }
+
+    [[nodiscard]] std::span<const Variant> variants(const Symbol& symbol) const {
+        return children(variantNodes, symbol.variants);
+    }
+
+    // Every word of every line, in reading order.
+    [[nodiscard]] std::span<const Word> allWords() const {
+        return wordNodes;
+    }
+
+    // Removes the words for which the predicate returns true. Lines, paragraphs and blocks left empty are removed too.
+    template<typename Predicate>
+    void eraseWords(Predicate&& predicate) {
+        std::vector<char> removedWords(wordNodes.size());
+        for (std::size_t wordIndex{}; wordIndex < wordNodes.size(); wordIndex++) {
+            removedWords[wordIndex] = predicate(std::as_const(wordNodes[wordIndex])) ? 1 : 0;
         }
-        confidence = { (confidence.getNormalized() + that.confidence.getNormalized()) / 2.0f, Confidence::Format::normalized };
+        removeWords(removedWords);
+    }
+
+    // Appends the blocks of another document. Its fonts are added to this document's fonts, and style references are updated.
+    void merge(Document&& that);
+
+private:
+
+    template<typename Node>
+    static std::span<const Node> children(const std::vector<Node>& nodes, ChildRange range) {
+        return { nodes.data() + range.first, range.count };
     }
 
+    void removeWords(const std::vector<char>& removedWords);
+
+    std::vector<Block> blockNodes;
+    std::vector<Paragraph> paragraphNodes;
+    std::vector<Line> lineNodes;
+    std::vector<Word> wordNodes;
+    std::vector<Symbol> symbolNodes;
+    std::vector<Variant> variantNodes;
+    std::string texts;
+
 };
 
 }
@@ -1,90 +1,66 @@
 #include "HuginMunin/HuginMuninTextDetector.hpp"
 
-#include <atomic>
-
 namespace frog {
 
 // classes:
 //   - background
 //   - text_line_horizontal
 //   - text_line_vertical
-constexpr std::string_view line_detection_py{ R"(import sys
-import cv2
-import logging
+constexpr std::string_view line_detection_py{ R"(import logging
 from doc_ufcn.main import DocUFCN
 if __name__ == '__main__':
-    image_path = sys.argv[1]
-    model_path = sys.argv[2]
-    logging.basicConfig(format="[%(levelname)s] %(message)s", stream=sys.stdout, level=logging.INFO)
-    image = cv2.cvtColor(cv2.imread(image_path), cv2.COLOR_BGR2RGB)
+    model_path = sys.argv[1]
+    logging.basicConfig(format="[%(levelname)s] %(message)s", stream=sys.stderr, level=logging.INFO)
     nb_of_classes = 3
     mean = [209, 204, 191]
     std = [51, 51, 50]
     input_size = 768
     model = DocUFCN(nb_of_classes, input_size, 'cpu')
     model.load(model_path, mean, std, mode="eval")
-    classes_with_polygons = model.predict(image, min_cc=50)
-    for class_with_polygons in classes_with_polygons:
-        if class_with_polygons is None:
-            continue
-        for class_index in class_with_polygons:
-            print('class', class_index)
-            for polygon in class_with_polygons[class_index]:
-                confidence = polygon['confidence']
-                points = polygon['polygon']
-                print('polygon', confidence)
-                for point in points:
-                    print(int(point[0]), int(point[1]), end=' ')
-                print()
-                print('end-polygon')
+    while True:
+        images = read_images()
+        if images is None:
+            break
+        for image in images:
+            # Doc-UFCN normalizes three channels, like the RGB images it was trained on.
+            if image.shape[2] == 1:
+                image = np.repeat(image, 3, axis=2)
+            output = []
+            classes_with_polygons = model.predict(image, min_cc=50)
+            for class_with_polygons in classes_with_polygons:
+                if class_with_polygons is None:
+                    continue
+                for class_index in class_with_polygons:
+                    output.append(f'class {class_index}\n')
+                    for polygon in class_with_polygons[class_index]:
+                        confidence = polygon['confidence']
+                        points = polygon['polygon']
+                        output.append(f'polygon {confidence}\n')
+                        output.append(' '.join(f'{int(point[0])} {int(point[1])}' for point in points))
+                        output.append('\nend-polygon\n')
+            write_text(''.join(output))
 )"
 };
 
-static std::atomic<int> huginMuninTextDetectorInstanceId{ 1 };
-
-HuginMuninTextDetector::HuginMuninTextDetector(const HuginMuninTextDetectorConfig& config_) : config{ config_ } {
-    instanceId = huginMuninTextDetectorInstanceId.fetch_add(1);
-    instanceTemporaryStorageDirectory = fmt::format("{}/{}", config.temporaryStorageDirectory, instanceId);
+std::unique_ptr<HuginMuninWorker> HuginMuninTextDetector::createWorker(const HuginMuninTextDetectorConfig& config, int processCount) {
+    return std::make_unique<HuginMuninWorker>("hugin-munin-line-detection", config.python, line_detection_py, std::vector<std::string>{ config.model }, config.temporaryStorageDirectory, processCount, 1, 1, std::chrono::milliseconds{ 0 });
+}
 
-    // Ensure the temporary storage for this instance exists and is empty.
-    std::error_code errorCode;
-    if (std::filesystem::exists(instanceTemporaryStorageDirectory, errorCode)) {
-        for (const auto& entry : std::filesystem::directory_iterator(instanceTemporaryStorageDirectory, errorCode)) {
-            std::filesystem::remove_all(entry.path(), errorCode);
-        }
-        std::filesystem::create_directory(instanceTemporaryStorageDirectory, errorCode);
-    } else {
-        std::filesystem::create_directories(config.temporaryStorageDirectory, errorCode);
+HuginMuninTextDetector::HuginMuninTextDetector(const HuginMuninTextDetectorConfig& config_, HuginMuninWorker* worker_) : config{ config_ }, worker{ worker_ } {
+    if (!worker) {
+        ownWorker = createWorker(config, 1);
+        worker = ownWorker.get();
     }
-
-    pythonScriptPath = fmt::format("{}/line-detection", instanceTemporaryStorageDirectory);
-    write_file(pythonScriptPath, fmt::format("#!{}\n{}", config.python, line_detection_py));
-    std::filesystem::permissions(pythonScriptPath, std::filesystem::perms::all, std::filesystem::perm_options::add, errorCode);
 }
 
 std::vector<Quad> HuginMuninTextDetector::detect(PIX* image, const TextDetectionSettings& settings) const {
-    const auto imageTempFilename = fmt::format("{}/full.jpg", instanceTemporaryStorageDirectory);
-    pixWrite(imageTempFilename.c_str(), image, IFF_JFIF_JPEG);
-
     // Run Doc-UFCN line detection
-    std::string docUfcnOut;
-    const auto commandTemp = fmt::format("{} {} {}", pythonScriptPath, imageTempFilename, config.model);
-    if (auto process = popen(reinterpret_cast<const char*>(commandTemp.c_str()), "r")) {
-        constexpr std::size_t bufferSize{ 1024 * 32 };
-        auto buffer = new char[bufferSize];
-        while (true) {
-            const auto readSize = std::fread(buffer, 1, bufferSize, process);
-            if (readSize == 0) {
-                break;
-            }
-            if (readSize < bufferSize && std::ferror(process) != 0) {
-                docUfcnOut = {};
-                break;
-            }
-            docUfcnOut.append(buffer, readSize);
-        }
-        pclose(process);
+    const auto responses = worker->run({ image });
+    if (!responses.has_value() || responses->size() != 1) {
+        log::error("Failed to run HuginMunin line detection.");
+        return {};
     }
+    const auto& docUfcnOut = responses->front();
 
     // Parse line results
     std::vector<Quad> quads;
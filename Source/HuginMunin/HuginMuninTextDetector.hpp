@@ -3,22 +3,28 @@
 #include "TextDetection.hpp"
 #include "Image.hpp"
 #include "Config.hpp"
+#include "HuginMunin/HuginMuninWorker.hpp"
+
+#include <memory>
 
 namespace frog {
 
+// Detects lines with Doc-UFCN in a worker process that keeps the model loaded.
 class HuginMuninTextDetector : public TextDetector {
 public:
 
-    HuginMuninTextDetector(const HuginMuninTextDetectorConfig& config);
+    static std::unique_ptr<HuginMuninWorker> createWorker(const HuginMuninTextDetectorConfig& config, int processCount);
+
+    // Without a shared worker, the detector starts its own worker process.
+    HuginMuninTextDetector(const HuginMuninTextDetectorConfig& config, HuginMuninWorker* worker = nullptr);
 
     std::vector<Quad> detect(PIX* image, const TextDetectionSettings& settings) const override;
 
 private:
 
     const HuginMuninTextDetectorConfig& config;
-    int instanceId{};
-    std::string instanceTemporaryStorageDirectory;
-    std::string pythonScriptPath;
+    std::unique_ptr<HuginMuninWorker> ownWorker;
+    HuginMuninWorker* worker{ nullptr };
 
 };
 
@@ -1,165 +1,157 @@
 #include "HuginMunin/HuginMuninTextRecognizer.hpp"
+#include "HuginMunin/PyLaiaSegmentation.hpp"
 #include "Image.hpp"
 
-#include <atomic>
-
 namespace frog {
 
-static std::atomic<int> huginMuninTextRecognizerInstanceId{ 1 };
-
-static std::string make_hugin_munin_segmentation_config_yaml(std::string_view modelDirectory, std::string_view temporaryStorageDirectory) {
-    std::string yaml;
-    yaml.reserve(1024);
-
-    yaml += "common:\n";
-    yaml += fmt::format("  model_filename: {}/model\n", modelDirectory);
-    yaml += fmt::format("  checkpoint: {}/weights.ckpt\n", modelDirectory);
-
-    yaml += "decode:\n";
-    yaml += "  convert_spaces: true\n";
-    yaml += "  join_string: ''\n";
-    yaml += "  print_line_confidence_scores: true\n";
-    yaml += "  print_word_confidence_scores: true\n";
-    yaml += "  segmentation: word\n";
-    yaml += "  temperature: 3.0\n";
-    yaml += fmt::format("  tokens_path: {}/tokens.txt\n", modelDirectory);
-    yaml += fmt::format("  lexicon_path: {}/lexicon.txt\n", modelDirectory);
-
-    yaml += "data:\n";
-    yaml += "  batch_size: 1\n";
-
-    yaml += fmt::format("syms: {}/syms.txt\n", modelDirectory);
-    yaml += fmt::format("img_list: {}/list.txt\n", temporaryStorageDirectory);
-    return yaml;
+// Decodes each line twice: with the language model for the text, and greedily for the word segmentation.
+// The lines of a request may come from several pages, and are decoded in one forward pass.
+// Each line gets two frames: "<confidence> <text>", and "[('<word>', x1, y1, x2, y2), ...]", like pylaia-htr-decode-ctc prints.
+constexpr std::string_view pylaia_decode_py{ R"(import logging
+import torch
+from laia.common.loader import ModelLoader
+from laia.data import PaddedTensor
+from laia.decoders import CTCGreedyDecoder, CTCLanguageDecoder
+from laia.utils import SymbolsTable
+
+def segment_words(path, frame_count, width, height, syms):
+    words = []
+    text = ''
+    start = 0
+    end = 0
+    previous = 0
+    for frame, symbol in enumerate(path):
+        if symbol != 0 and symbol != previous:
+            if syms[symbol] == '<space>':
+                if text:
+                    words.append((text, start, end))
+                text = ''
+            else:
+                if not text:
+                    start = frame
+                text += syms[symbol]
+        if symbol != 0 and syms[symbol] != '<space>':
+            end = frame + 1
+        previous = symbol
+    if text:
+        words.append((text, start, end))
+    scale = width / max(frame_count, 1)
+    return [(text, int(start * scale), 0, int(end * scale), height) for text, start, end in words]
+
+if __name__ == '__main__':
+    model_directory = sys.argv[1]
+    logging.basicConfig(format="[%(levelname)s] %(message)s", stream=sys.stderr, level=logging.INFO)
+    temperature = 3.0
+    syms = SymbolsTable(f'{model_directory}/syms.txt')
+    loader = ModelLoader(model_directory, filename='model', device='cpu')
+    model = loader.load_by(f'{model_directory}/weights.ckpt')
+    model.eval()
+    language_decoder = CTCLanguageDecoder(
+        language_model_path=f'{model_directory}/language_model.arpa',
+        lexicon_path=f'{model_directory}/lexicon.txt',
+        tokens_path=f'{model_directory}/tokens.txt',
+        language_model_weight=1.5,
+        temperature=temperature)
+    while True:
+        images = read_images()
+        if images is None:
+            break
+        if not images:
+            continue
+        # Inverted and scaled to [0, 1] like PyLaia's image transforms, and padded to the widest line.
+        height = max(image.shape[0] for image in images)
+        width = max(image.shape[1] for image in images)
+        batch = torch.zeros(len(images), 1, height, width)
+        for index, image in enumerate(images):
+            batch[index, 0, :image.shape[0], :image.shape[1]] = torch.from_numpy(255 - image[:, :, 0]).float() / 255.0
+        sizes = torch.tensor([[image.shape[0], image.shape[1]] for image in images])
+        with torch.no_grad():
+            output = model(PaddedTensor.build(batch, sizes))
+        decoded = language_decoder(output)
+        if isinstance(output, torch.nn.utils.rnn.PackedSequence):
+            output, lengths = torch.nn.utils.rnn.pad_packed_sequence(output)
+        else:
+            lengths = [output.size(0)] * len(images)
+        probabilities = torch.softmax(output / temperature, dim=-1)
+        for index, image in enumerate(images):
+            frame_count = int(lengths[index])
+            line_probabilities, path = probabilities[:frame_count, index].max(dim=-1)
+            kept = [float(p) for p, symbol in zip(line_probabilities, path) if int(symbol) != 0]
+            confidence = sum(kept) / len(kept) if kept else 0.0
+            text = ''.join(syms[symbol] for symbol in decoded['hyp'][index]).replace('<space>', ' ')
+            words = segment_words([int(symbol) for symbol in path], frame_count, image.shape[1], image.shape[0], syms)
+            write_text(f'{confidence:.2f} {text}')
+            write_text(repr(words))
+)"
+};
+
+static std::filesystem::path get_python_path(const HuginMuninTextRecognizerConfig& config) {
+    if (!config.python.empty()) {
+        return config.python;
+    }
+    // pylaia-htr-decode-ctc is installed next to the Python it runs with.
+    return std::filesystem::path{ config.pylaiaHtrDecodeCtcPath }.parent_path() / "python";
 }
 
-static std::string make_hugin_munin_decode_config_yaml(std::string_view modelDirectory, std::string_view temporaryStorageDirectory) {
-    std::string yaml;
-    yaml.reserve(1024);
-
-    yaml += "common:\n";
-    yaml += fmt::format("  model_filename: {}/model\n", modelDirectory);
-    yaml += fmt::format("  checkpoint: {}/weights.ckpt\n", modelDirectory);
-
-    yaml += "decode:\n";
-    yaml += "  convert_spaces: true\n";
-    yaml += "  join_string: ''\n";
-    yaml += "  use_language_model: true\n";
-    yaml += "  print_line_confidence_scores: true\n";
-    yaml += "  temperature: 3.0\n";
-    yaml += "  language_model_weight: 1.5\n";
-    yaml += fmt::format("  language_model_path: {}/language_model.arpa\n", modelDirectory);
-    yaml += fmt::format("  tokens_path: {}/tokens.txt\n", modelDirectory);
-    yaml += fmt::format("  lexicon_path: {}/lexicon.txt\n", modelDirectory);
-
-    yaml += "data:\n";
-    yaml += "  batch_size: 1\n";
-    //yaml += "  color_mode: RGB\n";
-
-    yaml += fmt::format("syms: {}/syms.txt\n", modelDirectory);
-    yaml += fmt::format("img_list: {}/list.txt\n", temporaryStorageDirectory);
-    return yaml;
+std::unique_ptr<HuginMuninWorker> HuginMuninTextRecognizer::createWorker(const HuginMuninTextRecognizerConfig& config, int processCount) {
+    const std::chrono::milliseconds maxLatency{ config.maxBatchLatencyMilliseconds };
+    return std::make_unique<HuginMuninWorker>("hugin-munin-pylaia-decode", get_python_path(config), pylaia_decode_py, std::vector<std::string>{ config.modelDirectory }, config.temporaryStorageDirectory, processCount, 2, config.maxBatchSize, maxLatency);
 }
 
-HuginMuninTextRecognizer::HuginMuninTextRecognizer(const HuginMuninTextRecognizerConfig& config_) : config{ config_ } {
-    instanceId = huginMuninTextRecognizerInstanceId.fetch_add(1);
-    instanceTemporaryStorageDirectory = fmt::format("{}/{}", config.temporaryStorageDirectory, instanceId);
-
-    // Ensure the temporary storage for this instance exists and is empty.
-    std::error_code errorCode;
-    if (std::filesystem::exists(instanceTemporaryStorageDirectory, errorCode)) {
-        for (const auto& entry : std::filesystem::directory_iterator(instanceTemporaryStorageDirectory, errorCode)) {
-            std::filesystem::remove_all(entry.path(), errorCode);
-        }
-        std::filesystem::create_directory(instanceTemporaryStorageDirectory, errorCode);
-    } else {
-        std::filesystem::create_directories(config.temporaryStorageDirectory, errorCode);
+HuginMuninTextRecognizer::HuginMuninTextRecognizer(const HuginMuninTextRecognizerConfig& config_, HuginMuninWorker* worker_) : config{ config_ }, worker{ worker_ } {
+    if (!worker) {
+        ownWorker = createWorker(config, 1);
+        worker = ownWorker.get();
     }
 }
 
-
 HuginMuninTextRecognizer::InputData HuginMuninTextRecognizer::createInputData(PIX* image, const std::vector<Quad>& quads) const {
     InputData inputData;
-    std::size_t quadIndex{};
     for (const auto& quad : quads) {
-        auto clippedPix = copy_pixels_in_quad(image, quad);
-        auto rotatedPix = pixRotate(clippedPix, -quad.bottomRightToLeftAngle(), L_ROTATE_AREA_MAP, L_BRING_IN_WHITE, 0, 0);
+        auto rotatedPix = crop_and_deskew_quad(image, quad, false);
+        auto grayPix = pixConvertTo8(rotatedPix, 0);
 
         // Scale with aspect to 128px height to fit model.
-        const auto factor = 128.0f / static_cast<float>(rotatedPix->h);
-        inputData.quadScaleFactors.push_back(static_cast<float>(rotatedPix->h) / 128.0f);
-        auto scaledPix = pixScale(rotatedPix, factor, factor);
+        const auto factor = 128.0f / static_cast<float>(grayPix->h);
+        inputData.quadScaleFactors.push_back(static_cast<float>(grayPix->h) / 128.0f);
+        inputData.lines.push_back(pixScale(grayPix, factor, factor));
 
-        // Write to temporary storage directory.
-        const auto imageFilename = fmt::format("{}/{}.jpg", instanceTemporaryStorageDirectory, quadIndex);
-        pixWrite(imageFilename.c_str(), scaledPix, IFF_JFIF_JPEG);
-
-        inputData.imagePathList += imageFilename;
-        inputData.imagePathList += "\n";
-
-        pixDestroy(&clippedPix);
         pixDestroy(&rotatedPix);
-        pixDestroy(&scaledPix);
-        quadIndex++;
+        pixDestroy(&grayPix);
     }
     return inputData;
 }
 
 Document HuginMuninTextRecognizer::recognize(PIX* image, const std::vector<Quad>& quads, std::vector<int> angles, const frog::TextRecognitionSettings& settings) const {
-    const auto& inputData = createInputData(image, quads);
-    write_file(fmt::format("{}/list.txt", instanceTemporaryStorageDirectory), inputData.imagePathList);
-
-    const auto segmentation_config_yaml = make_hugin_munin_segmentation_config_yaml(config.modelDirectory, instanceTemporaryStorageDirectory);
-    write_file(fmt::format("{}/config-segmentation.yaml", instanceTemporaryStorageDirectory), segmentation_config_yaml);
-
-    const auto decode_config_yaml = make_hugin_munin_decode_config_yaml(config.modelDirectory, instanceTemporaryStorageDirectory);
-    write_file(fmt::format("{}/config-decode.yaml", instanceTemporaryStorageDirectory), decode_config_yaml);
-
-    // Execute PyLaia
-    const auto segmentationCommand = fmt::format("{} --config \"{}/config-segmentation.yaml\"", config.pylaiaHtrDecodeCtcPath, instanceTemporaryStorageDirectory);
-    const auto decodeCommand = fmt::format("{} --config \"{}/config-decode.yaml\"", config.pylaiaHtrDecodeCtcPath, instanceTemporaryStorageDirectory);
-    const auto segmentationOut = executeProcessAndReturnResult(segmentationCommand);
-    const auto decodeOut = executeProcessAndReturnResult(decodeCommand);
-    const auto segmentationLines = split_string_view(segmentationOut, "\n");
-    const auto decodeLines = split_string_view(decodeOut, "\n");
-    if (segmentationLines.size() != decodeLines.size()) {
-        log::error("Different number of segmentation ({}) and decode ({}) lines.", segmentationLines.size(), decodeLines.size());
-        return {};
+    auto inputData = createInputData(image, quads);
+    const auto frames = worker->run(inputData.lines);
+    for (auto& line : inputData.lines) {
+        pixDestroy(&line);
     }
-    std::unordered_map<std::size_t, std::string_view> decodeLineByQuad;
-    std::unordered_map<std::size_t, std::string_view> segmentationLineByQuad;
-    for (const auto decodeLine : decodeLines) {
-        const auto [decodeQuadIndex, decodeLineOutput] = parsePyLaiaLineForIndexAndOutput(decodeLine);
-        if (decodeQuadIndex.has_value()) {
-            decodeLineByQuad[decodeQuadIndex.value()] = decodeLineOutput;
-        }
-    }
-    for (const auto segmentationLine : segmentationLines) {
-        const auto [segmentationQuadIndex, segmentationLineOutput] = parsePyLaiaLineForIndexAndOutput(segmentationLine);
-        if (segmentationQuadIndex.has_value()) {
-            segmentationLineByQuad[segmentationQuadIndex.value()] = segmentationLineOutput;
-        }
+    if (!frames.has_value() || frames->size() != quads.size() * 2) {
+        log::error("Failed to run PyLaia.");
+        return {};
     }
 
     // Parse results
     Document document;
+    std::vector<PyLaiaSegmentationWord> segmentationWords;
     for (std::size_t quadIndex{}; quadIndex < quads.size(); quadIndex++) {
-        if (!decodeLineByQuad.contains(quadIndex) || !segmentationLineByQuad.contains(quadIndex)) {
-            continue;
-        }
         const auto scaleFactor = inputData.quadScaleFactors[quadIndex];
-        const auto decodeLine = decodeLineByQuad[quadIndex];
-        const auto segmentationLine = segmentationLineByQuad[quadIndex];
+        const std::string_view decodeLine{ frames->at(quadIndex * 2) };
+        const std::string_view segmentationLine{ frames->at(quadIndex * 2 + 1) };
         const auto& quad = quads[quadIndex];
 
         const auto quadLeft = static_cast<int>(quad.left());
         const auto quadTop = static_cast<int>(quad.top());
 
-        Line line;
+        auto& block = document.addBlock();
+        auto& paragraph = document.addParagraph();
+        auto& line = document.addLine();
         line.width = static_cast<int>(quad.width());
         line.height = static_cast<int>(quad.height());
 
-        auto segmentationWords = parseSegmentationWords(segmentationLine);
+        parse_pylaia_segmentation_words(segmentationLine, segmentationWords);
         for (auto& word : segmentationWords) {
             word.x = static_cast<int>(static_cast<float>(word.x) * scaleFactor);
             word.y = static_cast<int>(static_cast<float>(word.y) * scaleFactor);
@@ -174,131 +166,59 @@ Document HuginMuninTextRecognizer::recognize(PIX* image, const std::vector<Quad>
         int wordCursorX{};
         std::size_t segmentedWordCursorIndex{};
         for (const auto decodeResultWord : split_string_view(decodeResult, " ")) {
-            Word word;
-            word.x = quadLeft + wordCursorX;
-            word.y = quadTop;
-            word.width = static_cast<int>(decodeResultWord.size()) * 20;
-            word.height = line.height;
-            word.text = decodeResultWord;
-            word.confidence = line.confidence;
+            auto x = quadLeft + wordCursorX;
+            auto y = quadTop;
+            auto width = static_cast<int>(decodeResultWord.size()) * 20;
+            auto height = line.height;
             bool foundSegmentedWord{};
             for (std::size_t segmentedWordIndex{ segmentedWordCursorIndex }; segmentedWordIndex < segmentationWords.size(); segmentedWordIndex++) {
                 const auto& segmentationWord = segmentationWords[segmentedWordIndex];
-                if (segmentationWord.text == word.text) {
-                    word = segmentationWord;
-                    wordCursorX += word.width;
+                if (pylaia_text_equals(segmentationWord.text, decodeResultWord)) {
+                    // Only the geometry is taken from the segmentation, which is relative to the line.
+                    x = quadLeft + segmentationWord.x;
+                    y = quadTop + segmentationWord.y;
+                    width = segmentationWord.width;
+                    height = segmentationWord.height;
+                    wordCursorX = segmentationWord.x + segmentationWord.width;
                     foundSegmentedWord = true;
                     segmentedWordCursorIndex = segmentedWordIndex + 1;
                     break;
                 }
             }
             if (!foundSegmentedWord) {
-                wordCursorX += static_cast<int>(word.text.size()) * 20;
+                wordCursorX += static_cast<int>(decodeResultWord.size()) * 20;
             }
             wordCursorX += 20;
-            if (word.confidence.getNormalized() > 0.8f) {
-                line.words.emplace_back(std::move(word));
+            if (line.confidence.getNormalized() > 0.8f) {
+                auto& word = document.addWord();
+                word.x = x;
+                word.y = y;
+                word.width = width;
+                word.height = height;
+                word.text = document.addText(decodeResultWord);
+                word.confidence = line.confidence;
             }
         }
 
-
         line.x = std::numeric_limits<int>::max();
         line.y = std::numeric_limits<int>::max();
-        for (const auto& word : line.words) {
+        for (const auto& word : document.words(line)) {
             line.x = std::min(line.x, word.x);
             line.y = std::min(line.y, word.y);
             line.width = std::max(line.width, word.width);
             line.height = std::max(line.height, word.height);
         }
 
-        Paragraph paragraph;
-        paragraph.x = line.x;
-        paragraph.y = line.y;
-        paragraph.width = line.width;
-        paragraph.height = line.height;
-        paragraph.lines.push_back(line);
-        Block block;
         block.x = line.x;
         block.y = line.y;
         block.width = line.width;
         block.height = line.height;
-        block.paragraphs.push_back(paragraph);
-        document.blocks.push_back(block);
+        paragraph.x = line.x;
+        paragraph.y = line.y;
+        paragraph.width = line.width;
+        paragraph.height = line.height;
     }
     return document;
 }
 
-std::string HuginMuninTextRecognizer::executeProcessAndReturnResult(const std::string& command) const {
-    std::string output;
-    if (auto process = popen(reinterpret_cast<const char*>(command.c_str()), "r")) {
-        constexpr std::size_t bufferSize{ 1024 * 32 };
-        auto buffer = new char[bufferSize];
-        while (true) {
-            const auto readSize = std::fread(buffer, 1, bufferSize, process);
-            if (readSize == 0) {
-                break;
-            }
-            if (readSize < bufferSize && std::ferror(process) != 0) {
-                output = {};
-                break;
-            }
-            output.append(buffer, readSize);
-        }
-        pclose(process);
-    }
-    return output;
-}
-
-std::pair<std::optional<std::size_t>, std::string_view> HuginMuninTextRecognizer::parsePyLaiaLineForIndexAndOutput(std::string_view line) const {
-    const auto endFilenameIndex = line.find(".jpg ");
-    if (endFilenameIndex == std::string_view::npos || endFilenameIndex <= 1) {
-        return {};
-    }
-    const auto endConfidenceIndex = line.find(' ', endFilenameIndex + 5);
-    if (endConfidenceIndex == std::string_view::npos) {
-        return {};
-    }
-    auto filename = line.substr(0, endFilenameIndex);
-    filename = filename.substr(filename.rfind('/') + 1);
-    return { from_string<std::size_t>(filename), line.substr(endFilenameIndex + 5) };
-}
-
-std::vector<Word> HuginMuninTextRecognizer::parseSegmentationWords(std::string_view segmentationLine) const {
-    thread_local std::regex pattern{ R"(\(([^'\)]*('[^']*'[^'\)]*)*)\))" };
-    std::vector<Word> words;
-    std::cregex_iterator matchesBegin{ segmentationLine.begin(), segmentationLine.end(), pattern };
-    std::cregex_iterator matchesEnd;
-    for (auto match = matchesBegin; match != matchesEnd; match++) {
-        const auto matchString = match->str(1);
-        if (matchString.starts_with("'<space>'")) {
-            continue;
-        }
-        const auto endTextIndex = matchString.find("', ");
-        if (endTextIndex == std::string_view::npos) {
-            continue;
-        }
-        const auto& parts = split_string_view(matchString.substr(endTextIndex + 2), ",");
-        if (parts.size() != 4) {
-            continue;
-        }
-        const auto x1 = from_string<int>(parts[0]);
-        const auto y1 = from_string<int>(parts[1]);
-        const auto x2 = from_string<int>(parts[2]);
-        const auto y2 = from_string<int>(parts[3]);
-        if (!x1.has_value() || !y1.has_value() || !x2.has_value() || !y2.has_value()) {
-            continue;
-        }
-        Word word;
-        word.x = x1.value();
-        word.y = y1.value();
-        word.width = x2.value() - x1.value();
-        word.height = y2.value() - y1.value();
-        word.text = segmentationLine.substr(0, endTextIndex);
-        if (word.text != "<space>") {
-            words.emplace_back(std::move(word));
-        }
-    }
-    return words;
-}
-
 }
@@ -2,34 +2,36 @@
 
 #include "TextRecognizer.hpp"
 #include "Config.hpp"
+#include "HuginMunin/HuginMuninWorker.hpp"
 
-#include <regex>
+#include <memory>
 
 namespace frog {
 
+// Recognizes handwritten lines with PyLaia in a worker process that keeps the model loaded.
+// Lines from pages recognized at the same time are decoded together.
 class HuginMuninTextRecognizer : public TextRecognizer {
 public:
 
     struct InputData {
         std::vector<float> quadScaleFactors;
-        std::string imagePathList;
+        std::vector<PIX*> lines; // Gray, and scaled to the model's height.
     };
 
-    HuginMuninTextRecognizer(const HuginMuninTextRecognizerConfig& config);
+    static std::unique_ptr<HuginMuninWorker> createWorker(const HuginMuninTextRecognizerConfig& config, int processCount);
+
+    // Without a shared worker, the recognizer starts its own worker process.
+    HuginMuninTextRecognizer(const HuginMuninTextRecognizerConfig& config, HuginMuninWorker* worker = nullptr);
 
     Document recognize(PIX* image, const std::vector<Quad>& quads, std::vector<int> angles, const TextRecognitionSettings& settings) const override;
 
 private:
 
     [[nodiscard]] InputData createInputData(PIX* image, const std::vector<Quad>& quads) const;
-    [[nodiscard]] std::string executeProcessAndReturnResult(const std::string& command) const;
-    [[nodiscard]] std::pair<std::optional<std::size_t>, std::string_view> parsePyLaiaLineForIndexAndOutput(std::string_view line) const;
-
-    std::vector<Word> parseSegmentationWords(std::string_view segmentationLine) const;
 
     const HuginMuninTextRecognizerConfig& config;
-    int instanceId{};
-    std::string instanceTemporaryStorageDirectory;
+    std::unique_ptr<HuginMuninWorker> ownWorker;
+    HuginMuninWorker* worker{ nullptr };
 
 };
 
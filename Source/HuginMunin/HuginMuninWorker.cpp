@@ -0,0 +1,343 @@
+#include "HuginMunin/HuginMuninWorker.hpp"
+#include "Core/Log.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <thread>
+
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace frog {
+
+// Prepended to every worker script.
+constexpr std::string_view worker_protocol_py{ R"(import os
+import struct
+import sys
+import numpy as np
+
+# The protocol owns the original stdin and stdout. Anything else printed goes to stderr.
+protocol_input = os.fdopen(os.dup(0), 'rb')
+protocol_output = os.fdopen(os.dup(1), 'wb')
+os.dup2(2, 1)
+
+def read_exact(size):
+    data = protocol_input.read(size)
+    if data is None or len(data) < size:
+        sys.exit(0)
+    return data
+
+def read_images():
+    header = protocol_input.read(4)
+    if header is None or len(header) < 4:
+        return None
+    (count,) = struct.unpack('<I', header)
+    images = []
+    for _ in range(count):
+        width, height, channels = struct.unpack('<III', read_exact(12))
+        pixels = read_exact(width * height * channels)
+        images.append(np.frombuffer(pixels, dtype=np.uint8).reshape(height, width, channels))
+    return images
+
+def write_text(text):
+    data = text.encode('utf-8')
+    protocol_output.write(struct.pack('<I', len(data)))
+    protocol_output.write(data)
+    protocol_output.flush()
+
+)"
+};
+
+static constexpr std::chrono::milliseconds stopTimeout{ 5000 };
+
+static void append_uint32(std::string& request, std::uint32_t value) {
+    for (int i{ 0 }; i < 4; i++) {
+        request.push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+    }
+}
+
+// Gray images are sent as they are, and anything else as RGB.
+static void append_image(std::string& request, PIX* pix) {
+    const auto width = static_cast<std::uint32_t>(pixGetWidth(pix));
+    const auto height = static_cast<std::uint32_t>(pixGetHeight(pix));
+    if (pixGetDepth(pix) == 8 && !pixGetColormap(pix)) {
+        append_uint32(request, width);
+        append_uint32(request, height);
+        append_uint32(request, 1);
+        const auto wordsPerLine = pixGetWpl(pix);
+        for (std::uint32_t y{ 0 }; y < height; y++) {
+            const auto line = pixGetData(pix) + y * wordsPerLine;
+            for (std::uint32_t x{ 0 }; x < width; x++) {
+                request.push_back(static_cast<char>(GET_DATA_BYTE(line, x)));
+            }
+        }
+        return;
+    }
+    auto rgbPix = pixConvertTo32(pix);
+    append_uint32(request, width);
+    append_uint32(request, height);
+    append_uint32(request, 3);
+    const auto wordsPerLine = pixGetWpl(rgbPix);
+    for (std::uint32_t y{ 0 }; y < height; y++) {
+        const auto line = pixGetData(rgbPix) + y * wordsPerLine;
+        for (std::uint32_t x{ 0 }; x < width; x++) {
+            l_int32 red{};
+            l_int32 green{};
+            l_int32 blue{};
+            extractRGBValues(line[x], &red, &green, &blue);
+            request.push_back(static_cast<char>(red));
+            request.push_back(static_cast<char>(green));
+            request.push_back(static_cast<char>(blue));
+        }
+    }
+    pixDestroy(&rgbPix);
+}
+
+static bool send_all(int socket, std::string_view data) {
+    while (!data.empty()) {
+        const auto sentSize = ::send(socket, data.data(), data.size(), MSG_NOSIGNAL);
+        if (sentSize < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sentSize <= 0) {
+            return false;
+        }
+        data.remove_prefix(static_cast<std::size_t>(sentSize));
+    }
+    return true;
+}
+
+static bool receive_all(int socket, char* data, std::size_t size) {
+    while (size > 0) {
+        const auto receivedSize = ::recv(socket, data, size, 0);
+        if (receivedSize < 0 && errno == EINTR) {
+            continue;
+        }
+        if (receivedSize <= 0) {
+            return false;
+        }
+        data += receivedSize;
+        size -= static_cast<std::size_t>(receivedSize);
+    }
+    return true;
+}
+
+static std::optional<std::vector<std::string>> exchange_frames(int socket, std::string_view request, std::size_t frameCount) {
+    if (!send_all(socket, request)) {
+        return std::nullopt;
+    }
+    std::vector<std::string> frames;
+    frames.reserve(frameCount);
+    for (std::size_t i{ 0 }; i < frameCount; i++) {
+        unsigned char header[4]{};
+        if (!receive_all(socket, reinterpret_cast<char*>(header), sizeof(header))) {
+            return std::nullopt;
+        }
+        const auto size = static_cast<std::uint32_t>(header[0]) | (static_cast<std::uint32_t>(header[1]) << 8) | (static_cast<std::uint32_t>(header[2]) << 16) | (static_cast<std::uint32_t>(header[3]) << 24);
+        auto& frame = frames.emplace_back(size, '\0');
+        if (!receive_all(socket, frame.data(), frame.size())) {
+            return std::nullopt;
+        }
+    }
+    return frames;
+}
+
+HuginMuninWorker::HuginMuninWorker(std::string name_, std::filesystem::path python_, std::string_view script, std::vector<std::string> arguments_, const std::filesystem::path& temporaryStorageDirectory, int processCount, int framesPerImage_, int maxBatchSize_, std::chrono::milliseconds maxLatency_)
+    : name{ std::move(name_) },
+      python{ std::move(python_) },
+      framesPerImage{ static_cast<std::size_t>(std::max(framesPerImage_, 1)) },
+      maxBatchSize{ static_cast<std::size_t>(std::max(maxBatchSize_, 1)) },
+      maxLatency{ std::max(maxLatency_, std::chrono::milliseconds{ 0 }) } {
+    std::error_code errorCode;
+    std::filesystem::create_directories(temporaryStorageDirectory, errorCode);
+    const auto scriptPath = temporaryStorageDirectory / fmt::format("{}.py", name);
+    if (!write_file(scriptPath, fmt::format("{}{}", worker_protocol_py, script))) {
+        log::error("Failed to write {} script to {}", name, scriptPath);
+    }
+    arguments.push_back(path_to_string(scriptPath));
+    arguments.insert(arguments.end(), arguments_.begin(), arguments_.end());
+
+    log::info("Starting {} {} processes: {} images per request, {} ms latency", std::max(processCount, 1), name, maxBatchSize, maxLatency.count());
+    processes.resize(static_cast<std::size_t>(std::max(processCount, 1)));
+    for (auto& process : processes) {
+        threads.emplace_back([this, &process] {
+            runProcess(process);
+        });
+    }
+}
+
+HuginMuninWorker::~HuginMuninWorker() {
+    {
+        std::lock_guard lock{ mutex };
+        stopping = true;
+    }
+    queued.notify_all();
+    for (auto& thread : threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+std::optional<std::vector<std::string>> HuginMuninWorker::run(const std::vector<PIX*>& images) {
+    if (images.empty()) {
+        return std::vector<std::string>{};
+    }
+    Request request;
+    for (auto image : images) {
+        append_image(request.images, image);
+    }
+    request.imageCount = images.size();
+    std::unique_lock lock{ mutex };
+    request.queuedAt = std::chrono::steady_clock::now();
+    pendingRequests.push_back(&request);
+    pendingImageCount += request.imageCount;
+    queued.notify_one();
+    completed.wait(lock, [&request] {
+        return request.done;
+    });
+    return std::move(request.frames);
+}
+
+void HuginMuninWorker::runProcess(Process& process) {
+    // Each process loads its model while the others do too.
+    start(process);
+    std::vector<Request*> batch;
+    std::string message;
+    while (true) {
+        std::size_t imageCount{};
+        {
+            std::unique_lock lock{ mutex };
+            while (true) {
+                if (pendingRequests.empty()) {
+                    if (stopping) {
+                        lock.unlock();
+                        stop(process);
+                        return;
+                    }
+                    queued.wait(lock);
+                    continue;
+                }
+                const auto deadline = pendingRequests.front()->queuedAt + maxLatency;
+                if (stopping || pendingImageCount >= maxBatchSize || deadline <= std::chrono::steady_clock::now()) {
+                    break;
+                }
+                queued.wait_until(lock, deadline);
+            }
+            // Requests are not split, so one larger than the batch size is sent on its own.
+            while (!pendingRequests.empty() && (batch.empty() || imageCount + pendingRequests.front()->imageCount <= maxBatchSize)) {
+                imageCount += pendingRequests.front()->imageCount;
+                batch.push_back(pendingRequests.front());
+                pendingRequests.pop_front();
+            }
+            pendingImageCount -= imageCount;
+            // Let another process pick up what is left.
+            if (!pendingRequests.empty()) {
+                queued.notify_one();
+            }
+        }
+
+        message.clear();
+        append_uint32(message, static_cast<std::uint32_t>(imageCount));
+        for (const auto request : batch) {
+            message += request->images;
+        }
+        auto frames = exchange(process, message, imageCount * framesPerImage);
+
+        {
+            std::lock_guard lock{ mutex };
+            std::size_t frameIndex{};
+            for (auto request : batch) {
+                const auto frameCount = request->imageCount * framesPerImage;
+                if (frames.has_value()) {
+                    const auto begin = frames->begin() + static_cast<std::ptrdiff_t>(frameIndex);
+                    request->frames.emplace(std::make_move_iterator(begin), std::make_move_iterator(begin + static_cast<std::ptrdiff_t>(frameCount)));
+                }
+                frameIndex += frameCount;
+                request->done = true;
+            }
+        }
+        completed.notify_all();
+        batch.clear();
+    }
+}
+
+std::optional<std::vector<std::string>> HuginMuninWorker::exchange(Process& process, std::string_view message, std::size_t frameCount) const {
+    // A process that died since the last request is restarted, and gets one more try.
+    for (int attempt{ 0 }; attempt < 2; attempt++) {
+        if (process.pid < 0 && !start(process)) {
+            return std::nullopt;
+        }
+        if (auto frames = exchange_frames(process.socket, message, frameCount)) {
+            return frames;
+        }
+        log::error("{} process {} failed, and will be restarted.", name, process.pid);
+        stop(process);
+    }
+    return std::nullopt;
+}
+
+bool HuginMuninWorker::start(Process& process) const {
+    int sockets[2]{ -1, -1 };
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0) {
+        log::error("Failed to create socket for {}: {}", name, std::strerror(errno));
+        return false;
+    }
+
+    // The child end becomes stdin and stdout. Both ends are closed in the child by exec, but not the duplicates.
+    posix_spawn_file_actions_t fileActions;
+    posix_spawn_file_actions_init(&fileActions);
+    posix_spawn_file_actions_adddup2(&fileActions, sockets[1], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&fileActions, sockets[1], STDOUT_FILENO);
+
+    const auto pythonString = path_to_string(python);
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(pythonString.c_str()));
+    for (const auto& argument : arguments) {
+        argv.push_back(const_cast<char*>(argument.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid{};
+    const auto result = posix_spawnp(&pid, pythonString.c_str(), &fileActions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&fileActions);
+    ::close(sockets[1]);
+    if (result != 0) {
+        log::error("Failed to start {} with {}: {}", name, python, std::strerror(result));
+        ::close(sockets[0]);
+        return false;
+    }
+    process.pid = static_cast<int>(pid);
+    process.socket = sockets[0];
+    return true;
+}
+
+void HuginMuninWorker::stop(Process& process) const {
+    if (process.socket >= 0) {
+        ::close(process.socket);
+        process.socket = -1;
+    }
+    if (process.pid < 0) {
+        return;
+    }
+    // The script exits when its input is closed.
+    const auto deadline = std::chrono::steady_clock::now() + stopTimeout;
+    while (::waitpid(process.pid, nullptr, WNOHANG) == 0) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            log::warning("{} process {} did not stop, and will be killed.", name, process.pid);
+            ::kill(process.pid, SIGKILL);
+            ::waitpid(process.pid, nullptr, 0);
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds{ 50 });
+    }
+    process.pid = -1;
+}
+
+}
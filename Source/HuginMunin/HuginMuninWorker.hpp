@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Image.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace frog {
+
+// Long-lived Python processes that load a model once, and then run it for each request.
+//
+// The script is given the protocol helpers below, and is connected to the worker by a Unix socket on its stdin and stdout.
+// Anything the script or its libraries print is redirected to stderr. All integers are 32-bit little-endian.
+//   Request:  image count, then for each image: width, height, channels (1 for gray, 3 for RGB), and the 8-bit pixels row by row.
+//   Response: framesPerImage frames for each image in order, each with the byte size and then the UTF-8 text.
+// Images submitted from several threads are gathered into shared requests. A request is sent when it holds maxBatchSize images,
+// or when its oldest image has waited for maxLatency. It then runs on the first idle process, and each caller gets the frames
+// of its own images back. A process that fails is restarted.
+class HuginMuninWorker {
+public:
+
+    HuginMuninWorker(std::string name, std::filesystem::path python, std::string_view script, std::vector<std::string> arguments, const std::filesystem::path& temporaryStorageDirectory, int processCount, int framesPerImage, int maxBatchSize, std::chrono::milliseconds maxLatency);
+    HuginMuninWorker(const HuginMuninWorker&) = delete;
+    HuginMuninWorker(HuginMuninWorker&&) = delete;
+
+    // Images already submitted are run, and then the processes are asked to stop by closing their input, and killed if they do not.
+    ~HuginMuninWorker();
+
+    HuginMuninWorker& operator=(const HuginMuninWorker&) = delete;
+    HuginMuninWorker& operator=(HuginMuninWorker&&) = delete;
+
+    // Blocks until the images have been run, and returns their frames. Returns std::nullopt if the process failed.
+    std::optional<std::vector<std::string>> run(const std::vector<PIX*>& images);
+
+private:
+
+    struct Process {
+        int pid{ -1 };
+        int socket{ -1 };
+    };
+
+    struct Request {
+        std::string images; // Encoded, without the count.
+        std::size_t imageCount{};
+        std::chrono::steady_clock::time_point queuedAt;
+        std::optional<std::vector<std::string>> frames;
+        bool done{};
+    };
+
+    void runProcess(Process& process);
+    std::optional<std::vector<std::string>> exchange(Process& process, std::string_view request, std::size_t frameCount) const;
+    bool start(Process& process) const;
+    void stop(Process& process) const;
+
+    const std::string name;
+    const std::filesystem::path python;
+    const std::size_t framesPerImage;
+    const std::size_t maxBatchSize;
+    const std::chrono::milliseconds maxLatency;
+    std::vector<std::string> arguments;
+
+    std::mutex mutex;
+    std::condition_variable queued;
+    std::condition_variable completed;
+    std::deque<Request*> pendingRequests;
+    std::size_t pendingImageCount{};
+    bool stopping{ false };
+    std::vector<Process> processes;
+    std::vector<std::thread> threads;
+
+};
+
+}
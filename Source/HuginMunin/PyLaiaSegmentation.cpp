@@ -0,0 +1,107 @@
+#include "HuginMunin/PyLaiaSegmentation.hpp"
+
+#include <charconv>
+
+namespace frog {
+
+static void skip_spaces(std::string_view& rest) {
+    while (!rest.empty() && rest.front() == ' ') {
+        rest.remove_prefix(1);
+    }
+}
+
+static bool consume_character(std::string_view& rest, char character) {
+    skip_spaces(rest);
+    if (rest.empty() || rest.front() != character) {
+        return false;
+    }
+    rest.remove_prefix(1);
+    return true;
+}
+
+static bool consume_int(std::string_view& rest, int& value) {
+    skip_spaces(rest);
+    const auto [end, error] = std::from_chars(rest.data(), rest.data() + rest.size(), value);
+    if (error != std::errc{}) {
+        return false;
+    }
+    rest.remove_prefix(static_cast<std::size_t>(end - rest.data()));
+    return true;
+}
+
+// Python's repr quotes with ' unless the string contains ' but not ", and escapes backslashes and the quote.
+static bool consume_python_string(std::string_view& rest, std::string_view& text) {
+    skip_spaces(rest);
+    if (rest.empty() || (rest.front() != '\'' && rest.front() != '"')) {
+        return false;
+    }
+    const auto quote = rest.front();
+    for (std::size_t index{ 1 }; index < rest.size(); index++) {
+        if (rest[index] == '\\') {
+            index++;
+        } else if (rest[index] == quote) {
+            text = rest.substr(1, index - 1);
+            rest.remove_prefix(index + 1);
+            return true;
+        }
+    }
+    rest = {};
+    return false;
+}
+
+void parse_pylaia_segmentation_words(std::string_view line, std::vector<PyLaiaSegmentationWord>& words) {
+    words.clear();
+    auto rest = line;
+    while (true) {
+        const auto tupleIndex = rest.find('(');
+        if (tupleIndex == std::string_view::npos) {
+            break;
+        }
+        rest.remove_prefix(tupleIndex + 1);
+        std::string_view text;
+        int x1{};
+        int y1{};
+        int x2{};
+        int y2{};
+        // A malformed tuple is skipped, and the next one is searched for from where it went wrong.
+        if (!consume_python_string(rest, text)) {
+            continue;
+        }
+        if (!consume_character(rest, ',') || !consume_int(rest, x1) || !consume_character(rest, ',') || !consume_int(rest, y1)) {
+            continue;
+        }
+        if (!consume_character(rest, ',') || !consume_int(rest, x2) || !consume_character(rest, ',') || !consume_int(rest, y2)) {
+            continue;
+        }
+        if (!consume_character(rest, ')') || text == "<space>") {
+            continue;
+        }
+        // PyLaia never writes these, and they could make the size overflow.
+        if (x1 < 0 || y1 < 0 || x2 < x1 || y2 < y1) {
+            continue;
+        }
+        words.push_back({ text, x1, y1, x2 - x1, y2 - y1 });
+    }
+}
+
+bool pylaia_text_equals(std::string_view segmentationText, std::string_view text) {
+    std::size_t textIndex{};
+    for (std::size_t index{}; index < segmentationText.size(); index++) {
+        auto character = segmentationText[index];
+        if (character == '\\' && index + 1 < segmentationText.size()) {
+            character = segmentationText[++index];
+            if (character == 'n') {
+                character = '\n';
+            } else if (character == 't') {
+                character = '\t';
+            }
+        }
+        if (textIndex == text.size() || text[textIndex] != character) {
+            return false;
+        }
+        textIndex++;
+    }
+    return textIndex == text.size();
+}
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+namespace frog {
+
+// A word of a line segmented by PyLaia, relative to the line image.
+struct PyLaiaSegmentationWord {
+    std::string_view text; // As written by Python's repr, without the quotes, so it may contain escape sequences.
+    int x{};
+    int y{};
+    int width{};
+    int height{};
+};
+
+// Reads the words of a line like "[('Hei', 0, 0, 52, 128), ('<space>', 52, 0, 56, 128), ...]" in one pass.
+// The words replace the contents of the vector, so its capacity can be reused between lines. Their text points into the line.
+// Malformed tuples and <space> are skipped.
+void parse_pylaia_segmentation_words(std::string_view line, std::vector<PyLaiaSegmentationWord>& words);
+
+// Compares the text of a segmentation word with decoded text, resolving escape sequences on the way.
+bool pylaia_text_equals(std::string_view segmentationText, std::string_view text);
+
+}
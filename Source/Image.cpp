@@ -2,58 +2,287 @@
 #include "Core/Log.hpp"
 #include "Core/Quad.hpp"
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
 namespace frog {
 
+// Finds where the row at y crosses the quad's edges, using the same rule as Quad::contains.
+// Returns the number of crossings written to xs, sorted from left to right.
+static int find_quad_row_crossings(const Quad& quad, float y, std::array<float, 4>& xs) {
+    const std::array<std::array<float, 4>, 4> edges{ {
+        { quad.x1, quad.y1, quad.x2, quad.y2 },
+        { quad.x2, quad.y2, quad.x3, quad.y3 },
+        { quad.x3, quad.y3, quad.x4, quad.y4 },
+        { quad.x4, quad.y4, quad.x1, quad.y1 }
+    } };
+    int count{};
+    for (const auto& [xa, ya, xb, yb] : edges) {
+        if ((ya <= y && yb > y) || (ya > y && yb <= y)) {
+            xs[count++] = (y - ya) * (xb - xa) / (yb - ya) + xa;
+        }
+    }
+    std::sort(xs.begin(), xs.begin() + count);
+    return count;
+}
+
 PIX* copy_pixels_in_quad(PIX* source, const Quad& quad) {
     const auto top = static_cast<int>(quad.top());
     const auto bottom = static_cast<int>(quad.bottom());
     const auto left = static_cast<int>(quad.left());
     const auto right = static_cast<int>(quad.right());
     auto destination = pixCreate(right - left, bottom - top, static_cast<int>(source->d));
+    if (!destination) {
+        return nullptr;
+    }
+    pixSetBlackOrWhite(destination, L_SET_WHITE);
+    const auto lastX = std::min({ right, left + pixGetWidth(destination) - 1, pixGetWidth(source) - 1 });
+    const auto lastY = std::min({ bottom, top + pixGetHeight(destination) - 1, pixGetHeight(source) - 1 });
+    std::array<float, 4> crossings{};
+    for (int y{ std::max(top, 0) }; y <= lastY; y++) {
+        const auto crossingCount = find_quad_row_crossings(quad, static_cast<float>(y), crossings);
+        // A pixel is inside when an odd number of crossings lie to its right, so spans run between crossing pairs.
+        for (int i{ 0 }; i + 1 < crossingCount; i += 2) {
+            const auto spanLeft = std::max({ static_cast<int>(std::ceil(crossings[i])), left, 0 });
+            const auto spanRight = std::min(static_cast<int>(std::ceil(crossings[i + 1])) - 1, lastX);
+            if (spanLeft <= spanRight) {
+                pixRasterop(destination, spanLeft - left, y - top, spanRight - spanLeft + 1, 1, PIX_SRC, source, spanLeft, y);
+            }
+        }
+    }
+    return destination;
+}
+
+// Below this, rotating a text line would not move any pixel noticeably (same threshold as leptonica's pixRotate).
+constexpr float negligible_deskew_angle{ 0.001f };
+
+// Below this, nearest neighbour sampling is indistinguishable from interpolation for recognition.
+constexpr float small_deskew_angle{ 0.035f };
+
+PIX* crop_and_deskew_quad(PIX* source, const Quad& quad, bool rotate180) {
+    auto angle = -quad.bottomRightToLeftAngle();
+    if (!std::isfinite(angle)) {
+        angle = 0.0f;
+    }
+    const auto depth = pixGetDepth(source);
+    const bool supported{ !pixGetColormap(source) && (depth == 1 || depth == 8 || depth == 32) };
+    if (std::abs(angle) < negligible_deskew_angle || !supported) {
+        auto destination = copy_pixels_in_quad(source, quad);
+        if (destination && std::abs(angle) >= negligible_deskew_angle) {
+            auto rotated = pixRotate(destination, angle, L_ROTATE_AREA_MAP, L_BRING_IN_WHITE, 0, 0);
+            pixDestroy(&destination);
+            destination = rotated;
+        }
+        if (destination && rotate180) {
+            pixRotate180(destination, destination);
+        }
+        return destination;
+    }
+
+    const auto top = static_cast<int>(quad.top());
+    const auto bottom = static_cast<int>(quad.bottom());
+    const auto left = static_cast<int>(quad.left());
+    const auto right = static_cast<int>(quad.right());
+    const auto width = right - left;
+    const auto height = bottom - top;
+    auto destination = pixCreate(width, height, depth);
+    if (!destination) {
+        return nullptr;
+    }
     pixSetBlackOrWhite(destination, L_SET_WHITE);
+
+    // Only pixels inside the quad are sampled, so neighbouring lines in the bounding box corners stay out.
+    // Each source row has at most two inside spans, stored as [begin, end) pairs.
+    const auto sourceWidth = pixGetWidth(source);
+    const auto sourceHeight = pixGetHeight(source);
+    std::vector<std::array<int, 4>> rowSpans(static_cast<std::size_t>(std::max(height + 1, 0)));
+    std::array<float, 4> crossings{};
     for (int y{ top }; y <= bottom; y++) {
-        for (int x{ left }; x <= right; x++) {
-            if (quad.contains(static_cast<float>(x), static_cast<float>(y))) {
+        auto& spans = rowSpans[y - top];
+        if (y < 0 || y >= sourceHeight) {
+            continue;
+        }
+        const auto crossingCount = find_quad_row_crossings(quad, static_cast<float>(y), crossings);
+        for (int i{ 0 }; i + 1 < crossingCount; i += 2) {
+            spans[i] = std::max({ static_cast<int>(std::ceil(crossings[i])), left, 0 });
+            spans[i + 1] = std::min({ static_cast<int>(std::ceil(crossings[i + 1])), right + 1, sourceWidth });
+        }
+    }
+    const auto isInside = [&](int x, int y) {
+        if (y < top || y > bottom) {
+            return false;
+        }
+        const auto& spans = rowSpans[y - top];
+        return (x >= spans[0] && x < spans[1]) || (x >= spans[2] && x < spans[3]);
+    };
+
+    const auto sourceData = pixGetData(source);
+    const auto sourceWpl = pixGetWpl(source);
+    const auto destinationData = pixGetData(destination);
+    const auto destinationWpl = pixGetWpl(destination);
+    constexpr l_uint32 white32{ 0xffffff00 };
+    const auto sample8 = [&](int x, int y) -> l_uint32 {
+        return isInside(x, y) ? GET_DATA_BYTE(sourceData + y * sourceWpl, x) : 255;
+    };
+    const auto sample32 = [&](int x, int y) -> l_uint32 {
+        return isInside(x, y) ? sourceData[y * sourceWpl + x] : white32;
+    };
+    const auto blend = [](l_uint32 a, l_uint32 b, l_uint32 c, l_uint32 d, float fx, float fy) {
+        const auto upper = static_cast<float>(a) + (static_cast<float>(b) - static_cast<float>(a)) * fx;
+        const auto lower = static_cast<float>(c) + (static_cast<float>(d) - static_cast<float>(c)) * fx;
+        return static_cast<l_uint32>(upper + (lower - upper) * fy + 0.5f);
+    };
+
+    // Inverse mapping, matching pixRotate: each destination pixel is rotated about the bounding box center into the source.
+    const auto sine = std::sin(angle);
+    const auto cosine = std::cos(angle);
+    const auto centerX = static_cast<float>(width / 2);
+    const auto centerY = static_cast<float>(height / 2);
+    const bool useNearest{ depth == 1 || std::abs(angle) < small_deskew_angle };
+    for (int destinationY{ 0 }; destinationY < height; destinationY++) {
+        const auto outputY = rotate180 ? height - 1 - destinationY : destinationY;
+        const auto destinationLine = destinationData + outputY * destinationWpl;
+        const auto dy = static_cast<float>(destinationY) - centerY;
+        for (int destinationX{ 0 }; destinationX < width; destinationX++) {
+            const auto outputX = rotate180 ? width - 1 - destinationX : destinationX;
+            const auto dx = static_cast<float>(destinationX) - centerX;
+            const auto sourceX = static_cast<float>(left) + centerX + dx * cosine + dy * sine;
+            const auto sourceY = static_cast<float>(top) + centerY - dx * sine + dy * cosine;
+            if (useNearest) {
+                const auto x = static_cast<int>(std::lround(sourceX));
+                const auto y = static_cast<int>(std::lround(sourceY));
+                if (!isInside(x, y)) {
+                    continue;
+                }
+                const auto sourceLine = sourceData + y * sourceWpl;
+                if (depth == 1) {
+                    if (GET_DATA_BIT(sourceLine, x)) {
+                        SET_DATA_BIT(destinationLine, outputX);
+                    }
+                } else if (depth == 8) {
+                    SET_DATA_BYTE(destinationLine, outputX, GET_DATA_BYTE(sourceLine, x));
+                } else {
+                    destinationLine[outputX] = sourceLine[x];
+                }
+                continue;
+            }
+            const auto x0 = static_cast<int>(std::floor(sourceX));
+            const auto y0 = static_cast<int>(std::floor(sourceY));
+            const auto fx = sourceX - static_cast<float>(x0);
+            const auto fy = sourceY - static_cast<float>(y0);
+            if (depth == 8) {
+                const auto value = blend(sample8(x0, y0), sample8(x0 + 1, y0), sample8(x0, y0 + 1), sample8(x0 + 1, y0 + 1), fx, fy);
+                SET_DATA_BYTE(destinationLine, outputX, value);
+            } else {
+                const auto a = sample32(x0, y0);
+                const auto b = sample32(x0 + 1, y0);
+                const auto c = sample32(x0, y0 + 1);
+                const auto d = sample32(x0 + 1, y0 + 1);
                 l_uint32 pixel{};
-                pixGetPixel(source, x, y, &pixel);
-                pixSetPixel(destination, x - left, y - top, pixel);
+                for (const int shift : { 24, 16, 8 }) {
+                    const auto channel = blend((a >> shift) & 0xff, (b >> shift) & 0xff, (c >> shift) & 0xff, (d >> shift) & 0xff, fx, fy);
+                    pixel |= std::min<l_uint32>(channel, 255) << shift;
+                }
+                destinationLine[outputX] = pixel;
             }
         }
     }
     return destination;
 }
 
+// Leptonica stores pixels in 32-bit words with the leftmost pixel in the most significant bits.
+// On little-endian machines the bytes of each word are therefore in reverse order in memory.
+constexpr bool pix_words_are_byte_swapped{ std::endian::native == std::endian::little };
+
+static void copy_1bpp_row_to_gray(const l_uint32* source, std::uint8_t* destination, int width) {
+    // Each source byte expands to 8 gray pixels. A set bit is black in leptonica.
+    static const auto expanded_bytes = [] {
+        std::array<std::array<std::uint8_t, 8>, 256> table{};
+        for (int byte{ 0 }; byte < 256; byte++) {
+            for (int bit{ 0 }; bit < 8; bit++) {
+                table[byte][bit] = (byte & (0x80 >> bit)) ? 0 : 255;
+            }
+        }
+        return table;
+    }();
+    const int full_words = width / 32;
+    for (int word_index{ 0 }; word_index < full_words; word_index++) {
+        const auto word = source[word_index];
+        for (int byte_index{ 0 }; byte_index < 4; byte_index++) {
+            const auto byte = (word >> (24 - 8 * byte_index)) & 0xff;
+            std::memcpy(destination, expanded_bytes[byte].data(), 8);
+            destination += 8;
+        }
+    }
+    for (int x{ full_words * 32 }; x < width; x++) {
+        *destination++ = GET_DATA_BIT(source, x) ? 0 : 255;
+    }
+}
+
+static void copy_8bpp_row_to_gray(const l_uint32* source, std::uint8_t* destination, int width) {
+    const int full_words = width / 4;
+    if constexpr (pix_words_are_byte_swapped) {
+        for (int word_index{ 0 }; word_index < full_words; word_index++) {
+            const auto word = std::byteswap(source[word_index]);
+            std::memcpy(destination + word_index * 4, &word, 4);
+        }
+    } else {
+        std::memcpy(destination, source, static_cast<std::size_t>(full_words) * 4);
+    }
+    for (int x{ full_words * 4 }; x < width; x++) {
+        destination[x] = static_cast<std::uint8_t>(GET_DATA_BYTE(source, x));
+    }
+}
+
 cv::Mat pix_to_mat(PIX* pix) {
     if (!pix) {
         log::error("Pix is nullptr.");
         return {};
     }
+    if (pixGetColormap(pix)) {
+        PIX* decoded = pixRemoveColormap(pix, REMOVE_CMAP_BASED_ON_SRC);
+        auto mat = pix_to_mat(decoded);
+        pixDestroy(&decoded);
+        return mat;
+    }
     const int width = pixGetWidth(pix);
     const int height = pixGetHeight(pix);
     const int depth = pixGetDepth(pix);
-    cv::Mat mat{ cv::Size(width, height), depth <= 8 ? CV_8UC1 : CV_8UC3 };
-    if (depth <= 8) {
-        for (int y = 0; y < height; y++) {
-            for (int x = 0; x < width; x++) {
-                l_uint32 val{};
-                pixGetPixel(pix, x, y, &val);
-                mat.at<uchar>(cv::Point{ x, y }) = static_cast<uchar>(255 * val);
-            }
+    const int words_per_line = pixGetWpl(pix);
+    const l_uint32* data = pixGetData(pix);
+    if (depth == 1) {
+        cv::Mat mat{ cv::Size(width, height), CV_8UC1 };
+        for (int y{ 0 }; y < height; y++) {
+            copy_1bpp_row_to_gray(data + y * words_per_line, mat.ptr<std::uint8_t>(y), width);
         }
-    } else if (depth >= 32) {
-        for (int y = 0; y < height; y++) {
-            for (int x = 0; x < width; x++) {
-                l_int32 r{};
-                l_int32 g{};
-                l_int32 b{};
-                pixGetRGBPixel(pix, x, y, &r, &g, &b);
-                mat.at<cv::Vec3b>(cv::Point{ x, y }) = { static_cast<std::uint8_t>(b), static_cast<std::uint8_t>(g), static_cast<std::uint8_t>(r) };
-            }
+        return mat;
+    } else if (depth == 8) {
+        cv::Mat mat{ cv::Size(width, height), CV_8UC1 };
+        for (int y{ 0 }; y < height; y++) {
+            copy_8bpp_row_to_gray(data + y * words_per_line, mat.ptr<std::uint8_t>(y), width);
         }
+        return mat;
+    } else if (depth == 32) {
+        // View the pixel words as 4-channel bytes without copying, and let OpenCV shuffle out BGR.
+        const cv::Mat rgba{ cv::Size(width, height), CV_8UC4, const_cast<l_uint32*>(data), static_cast<std::size_t>(words_per_line) * 4 };
+        cv::Mat mat{ cv::Size(width, height), CV_8UC3 };
+        // Destination channels are B, G, R. Source byte order is A, B, G, R on little-endian, and R, G, B, A otherwise.
+        constexpr std::array<int, 6> from_to{ pix_words_are_byte_swapped ? std::array<int, 6>{ 1, 0, 2, 1, 3, 2 } : std::array<int, 6>{ 2, 0, 1, 1, 0, 2 } };
+        cv::mixChannels(&rgba, 1, &mat, 1, from_to.data(), 3);
+        return mat;
+    } else if (depth == 2 || depth == 4 || depth == 16) {
+        PIX* gray = pixConvertTo8(pix, 0);
+        auto mat = pix_to_mat(gray);
+        pixDestroy(&gray);
+        return mat;
     } else {
         log::error("Unsupported bit depth: {}", depth);
+        return {};
     }
-    return mat;
 }
 
 }
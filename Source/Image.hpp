@@ -10,6 +10,11 @@ namespace frog {
 struct Quad;
 
 PIX* copy_pixels_in_quad(PIX* source, const Quad& quad);
+
+// Samples the pixels inside the quad directly into an upright image the size of the quad's bounding box.
+// Equivalent to copy_pixels_in_quad followed by pixRotate and an optional pixRotate180, without the intermediate images.
+PIX* crop_and_deskew_quad(PIX* source, const Quad& quad, bool rotate180);
+
 cv::Mat pix_to_mat(PIX* pix);
 
 }
@@ -13,6 +13,15 @@ constexpr std::string_view defaultConfiguration{
     "\t<Schemas>/etc/frog/schemas</Schemas>\n"
     "\t<RetryDatabaseConnectionIntervalSeconds>300</RetryDatabaseConnectionIntervalSeconds>\n"
     "\t<EmptyTaskQueueSleepIntervalSeconds>30</EmptyTaskQueueSleepIntervalSeconds>\n"
+    "\t<ReadAheadTaskCount>0</ReadAheadTaskCount>\n"
+    "\t<ReadAheadMemoryBudgetMegabytes>1024</ReadAheadMemoryBudgetMegabytes>\n"
+    "\t<LatencyModeMaxQueuedTasks>0</LatencyModeMaxQueuedTasks>\n"
+
+    "\t<!--<Pipeline>\n"
+    "\t\t<LoadThreadCount>2</LoadThreadCount>\n"
+    "\t\t<SaveThreadCount>2</SaveThreadCount>\n"
+    "\t\t<QueueCapacity>0</QueueCapacity>\n"
+    "\t</Pipeline>-->\n"
 
     "\t<Database role=\"all\">\n"
     "\t\t<Host>localhost</Host>\n"
@@ -22,6 +31,8 @@ constexpr std::string_view defaultConfiguration{
     "\t\t<Password>frog</Password>\n"
     "\t</Database>\n"
 
+    "\t<SambaClientCount>0</SambaClientCount>\n"
+    "\t<SambaDirectoriesInFlight>4</SambaDirectoriesInFlight>\n"
     "\t<!--<SambaCredentials>\n"
     "\t\t<Username></Username>\n"
     "\t\t<Password></Password>\n"
@@ -31,14 +42,30 @@ constexpr std::string_view defaultConfiguration{
     "\t\t<Tesseract>\n"
     "\t\t\t<Tessdata>/etc/frog/tessdata</Tessdata>\n"
     "\t\t\t<Dataset>nor</Dataset>\n"
+    "\t\t\t<EngineCount>0</EngineCount>\n"
+    "\t\t\t<EngineMemoryLimitMegabytes>0</EngineMemoryLimitMegabytes>\n"
+    "\t\t\t<MaxEnginesPerPage>1</MaxEnginesPerPage>\n"
     "\t\t</Tesseract>\n"
 
     "\t\t<PaddleTextDetector>\n"
     "\t\t\t<Model>/etc/frog/paddle/en_PP-OCRv3_det_infer</Model>\n"
+    "\t\t\t<!--<Batching>\n"
+    "\t\t\t\t<MaxBatchSize>8</MaxBatchSize>\n"
+    "\t\t\t\t<MaxLatencyMilliseconds>5</MaxLatencyMilliseconds>\n"
+    "\t\t\t\t<PredictorCount>2</PredictorCount>\n"
+    "\t\t\t\t<MathThreadCount>4</MathThreadCount>\n"
+    "\t\t\t</Batching>-->\n"
     "\t\t</PaddleTextDetector>\n"
 
+    "\t\t<!--<PaddleTextRecognizer>\n"
+    "\t\t\t<Model>/etc/frog/paddle/en_PP-OCRv4_rec_infer</Model>\n"
+    "\t\t\t<Labels>/etc/frog/paddle/Symbols.txt</Labels>\n"
+    "\t\t\t<BatchSize>8</BatchSize>\n"
+    "\t\t</PaddleTextRecognizer>-->\n"
+
     "\t\t<!--<PaddleTextAngleClassifier>\n"
     "\t\t\t<Model>/etc/frog/paddle/ch_ppocr_mobile_v2.0_cls_infer</Model>\n"
+    "\t\t\t<BatchSize>16</BatchSize>\n"
     "\t\t</PaddleTextAngleClassifier>-->\n"
     "\t</Profile>\n"
 
@@ -0,0 +1,198 @@
+#include "PaddleInferenceServer.hpp"
+#include "PaddleTextDetector.hpp"
+#include "PaddleTextAngleClassifier.hpp"
+#include "PaddleTextRecognizer.hpp"
+#include "Core/Log.hpp"
+
+namespace frog {
+
+PaddleInferenceServer::PaddleInferenceServer(std::string name_, const PredictorFactory& createPredictor, const PaddleBatchingConfig& config)
+    : name{ std::move(name_) }, maxBatchSize{ static_cast<std::size_t>(std::max(config.maxBatchSize, 1)) }, maxLatency{ std::max(config.maxLatencyMilliseconds, 0) } {
+    log::info("Initializing batched {} with {} predictors: {} samples per batch, {} ms latency", name, config.predictorCount, maxBatchSize, maxLatency.count());
+    for (int i{ 0 }; i < std::max(config.predictorCount, 1); i++) {
+        auto predictor = createPredictor(std::max(config.mathThreadCount, 1));
+        if (!predictor) {
+            log::error("Failed to create predictor for batched {}.", name);
+            continue;
+        }
+        threads.emplace_back([this, predictor] {
+            runPredictor(predictor);
+        });
+    }
+}
+
+PaddleInferenceServer::~PaddleInferenceServer() {
+    {
+        std::lock_guard lock{ mutex };
+        stopping = true;
+    }
+    queued.notify_all();
+    for (auto& thread : threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+std::vector<PaddleInferenceOutput> PaddleInferenceServer::infer(const std::vector<int>& sampleShape, const float* input, int sampleCount) {
+    if (sampleCount <= 0) {
+        return {};
+    }
+    if (threads.empty()) {
+        log::error("Batched {} has no predictors.", name);
+        return std::vector<PaddleInferenceOutput>(static_cast<std::size_t>(sampleCount));
+    }
+    Request request;
+    request.input = input;
+    request.sampleSize = std::accumulate(sampleShape.begin(), sampleShape.end(), std::size_t{ 1 }, std::multiplies<>());
+    request.outputs.resize(static_cast<std::size_t>(sampleCount));
+    request.remaining = sampleCount;
+    std::unique_lock lock{ mutex };
+    const auto now = std::chrono::steady_clock::now();
+    auto& samples = pendingSamples[sampleShape];
+    for (int i{ 0 }; i < sampleCount; i++) {
+        samples.emplace_back(Sample{ &request, i, now });
+    }
+    queued.notify_one();
+    completed.wait(lock, [&request] {
+        return request.remaining == 0;
+    });
+    return std::move(request.outputs);
+}
+
+PaddleInferenceServer::SampleQueues::iterator PaddleInferenceServer::findReadyBatch(std::chrono::steady_clock::time_point now, std::chrono::steady_clock::time_point& nextDeadline) {
+    auto oldest = pendingSamples.end();
+    for (auto it = pendingSamples.begin(); it != pendingSamples.end(); it++) {
+        if (it->second.size() >= maxBatchSize) {
+            return it;
+        }
+        if (oldest == pendingSamples.end() || it->second.front().queuedAt < oldest->second.front().queuedAt) {
+            oldest = it;
+        }
+    }
+    if (oldest == pendingSamples.end()) {
+        return oldest;
+    }
+    const auto deadline = oldest->second.front().queuedAt + maxLatency;
+    if (stopping || deadline <= now) {
+        return oldest;
+    }
+    nextDeadline = deadline;
+    return pendingSamples.end();
+}
+
+void PaddleInferenceServer::runPredictor(std::shared_ptr<paddle_infer::Predictor> predictor) {
+    const auto input_names = predictor->GetInputNames();
+    const auto output_names = predictor->GetOutputNames();
+    if (input_names.empty() || output_names.empty()) {
+        log::error("Batched {} has no input or output names.", name);
+        return;
+    }
+    auto inputTensor = predictor->GetInputHandle(input_names[0]);
+    auto outputTensor = predictor->GetOutputHandle(output_names[0]);
+    std::vector<float> inputBuffer;
+    std::vector<float> outputBuffer;
+    std::vector<Sample> batch;
+    std::vector<PaddleInferenceOutput> outputs;
+    while (true) {
+        std::vector<int> sampleShape;
+        {
+            std::unique_lock lock{ mutex };
+            while (true) {
+                if (stopping && pendingSamples.empty()) {
+                    return;
+                }
+                auto nextDeadline = std::chrono::steady_clock::time_point::max();
+                if (const auto ready = findReadyBatch(std::chrono::steady_clock::now(), nextDeadline); ready != pendingSamples.end()) {
+                    sampleShape = ready->first;
+                    auto& samples = ready->second;
+                    const auto count = std::min(samples.size(), maxBatchSize);
+                    batch.assign(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(count));
+                    samples.erase(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(count));
+                    if (samples.empty()) {
+                        pendingSamples.erase(ready);
+                    }
+                    break;
+                }
+                if (nextDeadline == std::chrono::steady_clock::time_point::max()) {
+                    queued.wait(lock);
+                } else {
+                    queued.wait_until(lock, nextDeadline);
+                }
+            }
+            // Let another predictor pick up what is left.
+            if (!pendingSamples.empty()) {
+                queued.notify_one();
+            }
+        }
+
+        const auto batch_count = static_cast<int>(batch.size());
+        const auto sample_size = batch.front().request->sampleSize;
+        inputBuffer.resize(batch.size() * sample_size);
+        for (std::size_t i{ 0 }; i < batch.size(); i++) {
+            const auto* source = batch[i].request->input + static_cast<std::size_t>(batch[i].index) * sample_size;
+            std::copy(source, source + sample_size, inputBuffer.begin() + static_cast<std::ptrdiff_t>(i * sample_size));
+        }
+        std::vector<int> input_shape{ batch_count };
+        input_shape.insert(input_shape.end(), sampleShape.begin(), sampleShape.end());
+        inputTensor->Reshape(input_shape);
+        inputTensor->CopyFromCpu(inputBuffer.data());
+
+        outputs.clear();
+        outputs.resize(batch.size());
+        if (predictor->Run()) {
+            const auto output_shape = outputTensor->shape();
+            const int out_num = std::accumulate(output_shape.begin(), output_shape.end(), 1, std::multiplies<>());
+            outputBuffer.resize(out_num);
+            outputTensor->CopyToCpu(outputBuffer.data());
+            const std::vector<int> output_sample_shape{ output_shape.begin() + 1, output_shape.end() };
+            const auto output_sample_size = static_cast<std::size_t>(out_num / std::max(batch_count, 1));
+            for (std::size_t i{ 0 }; i < batch.size(); i++) {
+                const auto begin = outputBuffer.begin() + static_cast<std::ptrdiff_t>(i * output_sample_size);
+                outputs[i].shape = output_sample_shape;
+                outputs[i].data.assign(begin, begin + static_cast<std::ptrdiff_t>(output_sample_size));
+            }
+        } else {
+            log::error("Batched {} failed to run a batch of {}.", name, batch_count);
+        }
+
+        {
+            std::lock_guard lock{ mutex };
+            for (std::size_t i{ 0 }; i < batch.size(); i++) {
+                auto& request = *batch[i].request;
+                request.outputs[static_cast<std::size_t>(batch[i].index)] = std::move(outputs[i]);
+                request.remaining--;
+            }
+        }
+        completed.notify_all();
+    }
+}
+
+template<typename Model, typename ModelConfig>
+static PaddleInferenceServer::PredictorFactory make_predictor_factory(const ModelConfig& config, PaddleModelRegistry* models) {
+    return [&config, models](int mathThreadCount) {
+        if (!models) {
+            return Model::createPredictor(config, mathThreadCount);
+        }
+        return models->clone(config.model, mathThreadCount, [&config, mathThreadCount] {
+            return Model::createPredictor(config, mathThreadCount);
+        });
+    };
+}
+
+PaddleInferenceServers::PaddleInferenceServers(const Profile& profile, PaddleModelRegistry* models) {
+    if (profile.paddleTextDetector.has_value() && profile.paddleTextDetector->batching.has_value()) {
+        const auto& config = profile.paddleTextDetector.value();
+        textDetector = std::make_unique<PaddleInferenceServer>("Paddle text detector", make_predictor_factory<PaddleTextDetector>(config, models), config.batching.value());
+    }
+    if (profile.paddleTextOrientationClassifier.has_value() && profile.paddleTextOrientationClassifier->batching.has_value()) {
+        const auto& config = profile.paddleTextOrientationClassifier.value();
+        textAngleClassifier = std::make_unique<PaddleInferenceServer>("Paddle text angle classifier", make_predictor_factory<PaddleTextAngleClassifier>(config, models), config.batching.value());
+    }
+    if (profile.paddleTextRecognizer.has_value() && profile.paddleTextRecognizer->batching.has_value()) {
+        const auto& config = profile.paddleTextRecognizer.value();
+        textRecognizer = std::make_unique<PaddleInferenceServer>("Paddle text recognizer", make_predictor_factory<PaddleTextRecognizer>(config, models), config.batching.value());
+    }
+}
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "paddle_api.h"
+#include "paddle_inference_api.h"
+
+#include "Config.hpp"
+#include "PaddleModelRegistry.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace frog {
+
+// Output of one sample. The shape does not include the batch dimension.
+struct PaddleInferenceOutput {
+    std::vector<int> shape;
+    std::vector<float> data;
+};
+
+// Runs inference for samples submitted from many threads as shared batches.
+// Samples with the same shape are queued together. A batch is closed when it is full, or when its oldest sample has waited
+// for the configured latency. It then runs on the first free predictor, and each output is handed back to its caller.
+class PaddleInferenceServer {
+public:
+
+    using PredictorFactory = std::function<std::shared_ptr<paddle_infer::Predictor>(int mathThreadCount)>;
+
+    PaddleInferenceServer(std::string name, const PredictorFactory& createPredictor, const PaddleBatchingConfig& config);
+    PaddleInferenceServer(const PaddleInferenceServer&) = delete;
+    PaddleInferenceServer(PaddleInferenceServer&&) = delete;
+
+    // Samples already submitted are run before this returns.
+    ~PaddleInferenceServer();
+
+    PaddleInferenceServer& operator=(const PaddleInferenceServer&) = delete;
+    PaddleInferenceServer& operator=(PaddleInferenceServer&&) = delete;
+
+    // Input holds sampleCount samples of sampleShape, one after the other. Blocks until all of them have been run.
+    // If inference fails, the outputs are empty.
+    std::vector<PaddleInferenceOutput> infer(const std::vector<int>& sampleShape, const float* input, int sampleCount);
+
+private:
+
+    struct Request {
+        const float* input{};
+        std::size_t sampleSize{};
+        std::vector<PaddleInferenceOutput> outputs;
+        int remaining{};
+    };
+
+    struct Sample {
+        Request* request{};
+        int index{};
+        std::chrono::steady_clock::time_point queuedAt;
+    };
+
+    using SampleQueues = std::map<std::vector<int>, std::deque<Sample>>;
+
+    void runPredictor(std::shared_ptr<paddle_infer::Predictor> predictor);
+    SampleQueues::iterator findReadyBatch(std::chrono::steady_clock::time_point now, std::chrono::steady_clock::time_point& nextDeadline);
+
+    const std::string name;
+    const std::size_t maxBatchSize;
+    const std::chrono::milliseconds maxLatency;
+
+    std::mutex mutex;
+    std::condition_variable queued;
+    std::condition_variable completed;
+    SampleQueues pendingSamples;
+    bool stopping{ false };
+    std::vector<std::thread> threads;
+
+};
+
+// Inference servers for the Paddle models in a profile that have batching configured. They are shared by every task processor.
+// If a model registry is given, the predictors of each server are clones that share the weights.
+struct PaddleInferenceServers {
+    std::unique_ptr<PaddleInferenceServer> textDetector;
+    std::unique_ptr<PaddleInferenceServer> textAngleClassifier;
+    std::unique_ptr<PaddleInferenceServer> textRecognizer;
+
+    PaddleInferenceServers(const Profile& profile, PaddleModelRegistry* models = nullptr);
+};
+
+}
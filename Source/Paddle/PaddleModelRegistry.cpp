@@ -0,0 +1,21 @@
+#include "PaddleModelRegistry.hpp"
+#include "Core/Log.hpp"
+
+namespace frog {
+
+std::shared_ptr<paddle_infer::Predictor> PaddleModelRegistry::clone(const std::filesystem::path& model, int mathThreadCount, const PredictorFactory& createPredictor) {
+    std::lock_guard lock{ mutex };
+    auto& predictor = predictors[{ model, mathThreadCount }];
+    if (!predictor) {
+        predictor = createPredictor();
+        if (!predictor) {
+            predictors.erase({ model, mathThreadCount });
+            return nullptr;
+        }
+        log::info("Loaded Paddle model {}. Further predictors will share its weights.", model);
+        // The first predictor stays in the registry, so every caller gets a clone, and none of them share scope.
+    }
+    return predictor->Clone();
+}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "paddle_api.h"
+#include "paddle_inference_api.h"
+
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace frog {
+
+// Loads each Paddle model once, and hands out clones of its predictor. Clones share the loaded and optimized weights,
+// but have their own scope for intermediate tensors, so each one can run on its own thread.
+class PaddleModelRegistry {
+public:
+
+    using PredictorFactory = std::function<std::shared_ptr<paddle_infer::Predictor>()>;
+
+    PaddleModelRegistry() = default;
+    PaddleModelRegistry(const PaddleModelRegistry&) = delete;
+    PaddleModelRegistry(PaddleModelRegistry&&) = delete;
+
+    ~PaddleModelRegistry() = default;
+
+    PaddleModelRegistry& operator=(const PaddleModelRegistry&) = delete;
+    PaddleModelRegistry& operator=(PaddleModelRegistry&&) = delete;
+
+    // The first call for a model and thread count creates the predictor with createPredictor. Later calls clone it.
+    // The CPU math thread count is part of the key, since clones inherit it from the predictor they are cloned from.
+    std::shared_ptr<paddle_infer::Predictor> clone(const std::filesystem::path& model, int mathThreadCount, const PredictorFactory& createPredictor);
+
+private:
+
+    std::mutex mutex;
+    std::map<std::pair<std::filesystem::path, int>, std::shared_ptr<paddle_infer::Predictor>> predictors;
+
+};
+
+}
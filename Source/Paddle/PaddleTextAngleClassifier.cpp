@@ -15,14 +15,21 @@ static void classification_resize_image(const cv::Mat& img, cv::Mat& resize_img,
 }
 
 static cv::Mat get_rotated_cropped_image(const cv::Mat& srcimage, Quad quad) {
-    const auto left = quad.left();
-    const auto top = quad.top();
-
-    cv::Mat image;
-    srcimage.copyTo(image);
-
-    cv::Mat img_crop;
-    image(cv::Rect2f(left, top, quad.right() - left, quad.bottom() - top)).copyTo(img_crop);
+    // Crop from a view of the page, clamped to its bounds, instead of copying the page for every quad.
+    const cv::Rect bounds{ 0, 0, srcimage.cols, srcimage.rows };
+    const cv::Rect quad_rect{
+        static_cast<int>(std::lround(quad.left())),
+        static_cast<int>(std::lround(quad.top())),
+        static_cast<int>(std::lround(quad.width())),
+        static_cast<int>(std::lround(quad.height()))
+    };
+    const auto crop_rect = quad_rect & bounds;
+    if (crop_rect.empty()) {
+        return {};
+    }
+    const auto left = static_cast<float>(crop_rect.x);
+    const auto top = static_cast<float>(crop_rect.y);
+    const cv::Mat img_crop = srcimage(crop_rect);
     quad.x1 -= left;
     quad.y1 -= top;
     quad.x2 -= left;
@@ -63,18 +70,17 @@ static cv::Mat get_rotated_cropped_image(const cv::Mat& srcimage, Quad quad) {
     }
 }
 
-PaddleTextAngleClassifier::PaddleTextAngleClassifier(const PaddleTextAngleClassifierConfig& config) {
+std::shared_ptr<paddle_infer::Predictor> PaddleTextAngleClassifier::createPredictor(const PaddleTextAngleClassifierConfig& config, int mathThreadCount) {
     if (!std::filesystem::exists(config.model)) {
         log::error("Unable to find detection model at configured path: {}", config.model);
-        return;
+        return nullptr;
     }
-    log::info("Initializing Paddle text angle classifier ({})", config.model);
     const auto model_directory = path_to_string(config.model);
     paddle_infer::Config paddleConfig;
     paddleConfig.SetModel(model_directory + "/inference.pdmodel", model_directory + "/inference.pdiparams");
     paddleConfig.DisableGpu();
     paddleConfig.EnableMKLDNN();
-    paddleConfig.SetCpuMathLibraryNumThreads(1);
+    paddleConfig.SetCpuMathLibraryNumThreads(mathThreadCount);
     paddleConfig.SwitchUseFeedFetchOps(false);
     paddleConfig.SwitchSpecifyInputNames(true);
     paddleConfig.SwitchIrOptim(true);
@@ -82,67 +88,112 @@ PaddleTextAngleClassifier::PaddleTextAngleClassifier(const PaddleTextAngleClassi
 #ifndef FROG_DEBUG_LOG_PADDLE
     paddleConfig.DisableGlogInfo();
 #endif
-    predictor = paddle_infer::CreatePredictor(paddleConfig);
+    return paddle_infer::CreatePredictor(paddleConfig);
+}
+
+PaddleTextAngleClassifier::PaddleTextAngleClassifier(const PaddleTextAngleClassifierConfig& config, PaddleInferenceServer* server_, PaddleModelRegistry* models) : server{ server_ } {
+    batchSize = std::max(config.batchSize, 1);
+    if (server) {
+        return;
+    }
+    log::info("Initializing Paddle text angle classifier ({})", config.model);
+    if (models) {
+        predictor = models->clone(config.model, 1, [&config] {
+            return createPredictor(config, 1);
+        });
+    } else {
+        predictor = createPredictor(config, 1);
+    }
+    if (!predictor) {
+        return;
+    }
+
+    const auto input_names = predictor->GetInputNames();
+    if (input_names.empty()) {
+        log::error("Input names are empty.");
+        return;
+    }
+    inputTensor = predictor->GetInputHandle(input_names[0]);
+    const auto output_names = predictor->GetOutputNames();
+    if (output_names.empty()) {
+        log::error("Output names are empty.");
+        return;
+    }
+    outputTensor = predictor->GetOutputHandle(output_names[0]);
 }
 
 std::vector<Classification> PaddleTextAngleClassifier::classify(PIX* pix, const std::vector<Quad>& quads) {
-    constexpr int tensor1{ 3 }; // I don't know what this is for.
+    constexpr int channels{ 3 };
     constexpr int width{ 192 };
     constexpr int height{ 48 };
+    constexpr int input_size{ channels * height * width };
 
+    if (!server && (!inputTensor || !outputTensor)) {
+        log::error("Paddle text angle classifier is not initialized.");
+        return {};
+    }
+
+    const std::vector<float> mean{ 0.5f, 0.5f, 0.5f };
+    const std::vector<float> scale{ 1.0f / 0.5f, 1.0f / 0.5f, 1.0f / 0.5f };
     const auto image_matrix = pix_to_mat(pix);
     std::vector<Classification> classifications;
     classifications.reserve(quads.size());
-    for (const auto& quad : quads) {
-        auto quad_matrix = get_rotated_cropped_image(image_matrix, quad);
-        cv::Mat resize_img;
-        classification_resize_image(quad_matrix, resize_img, 192, 48);
-        std::vector<float> mean{ 0.5f, 0.5f, 0.5f };
-        std::vector<float> scale{ 1.0f / 0.5f, 1.0f / 0.5f, 1.0f / 0.5f };
-        bool is_scale{ true };
-        normalize(&resize_img, mean, scale, is_scale);
-        if (resize_img.cols < width) {
-            cv::copyMakeBorder(resize_img, resize_img, 0, 0, 0, width - resize_img.cols, cv::BORDER_CONSTANT, cv::Scalar(0, 0, 0));
+    for (std::size_t batch_start{ 0 }; batch_start < quads.size(); batch_start += batchSize) {
+        const auto batch_count = static_cast<int>(std::min(quads.size() - batch_start, static_cast<std::size_t>(batchSize)));
+        inputBuffer.resize(static_cast<std::size_t>(batch_count) * input_size);
+        for (int i{ 0 }; i < batch_count; i++) {
+            auto quad_matrix = get_rotated_cropped_image(image_matrix, quads[batch_start + i]);
+            float* input = inputBuffer.data() + static_cast<std::size_t>(i) * input_size;
+            if (quad_matrix.empty()) {
+                std::fill(input, input + input_size, 0.0f);
+                continue;
+            }
+            if (quad_matrix.channels() == 1) {
+                cv::cvtColor(quad_matrix, quad_matrix, cv::COLOR_GRAY2BGR);
+            }
+            cv::Mat resize_img;
+            classification_resize_image(quad_matrix, resize_img, width, height);
+            normalize(&resize_img, mean, scale, true);
+            if (resize_img.cols < width) {
+                cv::copyMakeBorder(resize_img, resize_img, 0, 0, 0, width - resize_img.cols, cv::BORDER_CONSTANT, cv::Scalar(0, 0, 0));
+            }
+            permute_rgb_to_chw(resize_img, input);
         }
 
-        std::vector<float> input;
-        input.resize(tensor1 * height * width);
-        permute_rgb_to_chw(resize_img, input.data());
-
-        auto input_names = predictor->GetInputNames();
-        if (input_names.empty()) {
-            log::error("Input names are empty.{}");
-            return {};
+        int label_count{};
+        if (server) {
+            const auto outputs = server->infer({ channels, height, width }, inputBuffer.data(), batch_count);
+            if (outputs.empty() || outputs[0].shape.empty() || outputs[0].data.empty()) {
+                return {};
+            }
+            label_count = outputs[0].shape[0];
+            outputBuffer.resize(static_cast<std::size_t>(batch_count) * label_count);
+            for (int i{ 0 }; i < batch_count; i++) {
+                if (outputs[i].data.size() != static_cast<std::size_t>(label_count)) {
+                    return {};
+                }
+                std::ranges::copy(outputs[i].data, outputBuffer.begin() + i * label_count);
+            }
+        } else {
+            inputTensor->Reshape({ batch_count, channels, height, width });
+            inputTensor->CopyFromCpu(inputBuffer.data());
+            predictor->Run();
+
+            const auto predict_shape = outputTensor->shape();
+            const int out_num = std::accumulate(predict_shape.begin(), predict_shape.end(), 1, std::multiplies<>());
+            outputBuffer.resize(out_num);
+            outputTensor->CopyToCpu(outputBuffer.data());
+            label_count = predict_shape[1];
         }
-        auto input_t = predictor->GetInputHandle(input_names[0]);
-        if (!input_t) {
-            log::error("Input is nullptr.");
-            return {};
-        }
-        input_t->Reshape({ 1, tensor1, height, width });
-        input_t->CopyFromCpu(input.data());
-        predictor->Run();
-
-        std::vector<float> predict_batch;
-        auto output_names = predictor->GetOutputNames();
-        if (output_names.empty()) {
-            log::error("Output names are empty.{}");
-            return {};
-        }
-        auto output_t = predictor->GetOutputHandle(output_names[0]);
-        if (!output_t) {
-            log::error("Output is nullptr.");
-            return {};
+
+        for (int i{ 0 }; i < batch_count; i++) {
+            const auto begin = outputBuffer.begin() + i * label_count;
+            const auto best = std::max_element(begin, begin + label_count);
+            Classification classification;
+            classification.label = static_cast<unsigned int>(std::distance(begin, best));
+            classification.confidence = *best;
+            classifications.push_back(classification);
         }
-        auto predict_shape = output_t->shape();
-        int out_num = std::accumulate(predict_shape.begin(), predict_shape.end(), 1, std::multiplies<>());
-        predict_batch.resize(out_num);
-        output_t->CopyToCpu(predict_batch.data());
-
-        Classification classification;
-        classification.label = std::distance(&predict_batch[0], std::max_element(&predict_batch[0], &predict_batch[predict_shape[1]]));
-        classification.confidence = *std::max_element(&predict_batch[0], &predict_batch[predict_shape[1]]);
-        classifications.push_back(classification);
     }
     return classifications;
 }
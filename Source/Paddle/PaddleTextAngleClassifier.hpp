@@ -4,6 +4,8 @@
 #include "paddle_inference_api.h"
 #include "utility.hpp"
 #include "Image.hpp"
+#include "PaddleInferenceServer.hpp"
+#include "PaddleModelRegistry.hpp"
 
 namespace frog {
 
@@ -20,13 +22,23 @@ struct Classification {
 
 struct PaddleTextAngleClassifier {
 
-    PaddleTextAngleClassifier(const PaddleTextAngleClassifierConfig& config);
+    // If an inference server is given, classification runs through it instead of a predictor owned by this classifier.
+    // Otherwise, the predictor is cloned from the model registry if given, so that the weights are shared.
+    PaddleTextAngleClassifier(const PaddleTextAngleClassifierConfig& config, PaddleInferenceServer* server = nullptr, PaddleModelRegistry* models = nullptr);
+
+    static std::shared_ptr<paddle_infer::Predictor> createPredictor(const PaddleTextAngleClassifierConfig& config, int mathThreadCount);
 
     std::vector<Classification> classify(PIX* image, const std::vector<Quad>& quads);
 
 private:
 
     std::shared_ptr<paddle_infer::Predictor> predictor;
+    std::unique_ptr<paddle_infer::Tensor> inputTensor;
+    std::unique_ptr<paddle_infer::Tensor> outputTensor;
+    std::vector<float> inputBuffer;
+    std::vector<float> outputBuffer;
+    PaddleInferenceServer* server{};
+    int batchSize{ 1 };
 
 };
 
@@ -240,11 +240,10 @@ std::vector<Quad> filter_tag_det_res(std::vector<Quad> boxes, float ratio_h, flo
     return root_points;
 }
 
-PaddleTextDetector::PaddleTextDetector(const PaddleTextDetectorConfig& config) {
-    log::info("Initializing Paddle text detector ({})", config.model);
+std::shared_ptr<paddle_infer::Predictor> PaddleTextDetector::createPredictor(const PaddleTextDetectorConfig& config, int mathThreadCount) {
     if (!std::filesystem::exists(config.model)) {
         log::error("Unable to find detection model at configured path: {}", config.model);
-        return;
+        return nullptr;
     }
     const auto model_directory = path_to_string(config.model);
     paddle_infer::Config paddleConfig;
@@ -252,7 +251,7 @@ PaddleTextDetector::PaddleTextDetector(const PaddleTextDetectorConfig& config) {
     paddleConfig.DisableGpu();
     paddleConfig.EnableMKLDNN();
     paddleConfig.SetMkldnnCacheCapacity(10);
-    paddleConfig.SetCpuMathLibraryNumThreads(1);
+    paddleConfig.SetCpuMathLibraryNumThreads(mathThreadCount);
     paddleConfig.SwitchUseFeedFetchOps(false);
     paddleConfig.SwitchSpecifyInputNames(true);
     paddleConfig.SwitchIrOptim(true);
@@ -260,7 +259,21 @@ PaddleTextDetector::PaddleTextDetector(const PaddleTextDetectorConfig& config) {
 #ifndef FROG_DEBUG_LOG_PADDLE
     paddleConfig.DisableGlogInfo();
 #endif
-    predictor = paddle_infer::CreatePredictor(paddleConfig);
+    return paddle_infer::CreatePredictor(paddleConfig);
+}
+
+PaddleTextDetector::PaddleTextDetector(const PaddleTextDetectorConfig& config, PaddleInferenceServer* server_, PaddleModelRegistry* models) : server{ server_ } {
+    if (server) {
+        return;
+    }
+    log::info("Initializing Paddle text detector ({})", config.model);
+    if (models) {
+        predictor = models->clone(config.model, 1, [&config] {
+            return createPredictor(config, 1);
+        });
+    } else {
+        predictor = createPredictor(config, 1);
+    }
 }
 
 std::vector<Quad> PaddleTextDetector::detect(PIX* image, const TextDetectionSettings& settings) const {
@@ -282,28 +295,43 @@ std::vector<Quad> PaddleTextDetector::detect(PIX* image, const TextDetectionSett
     std::vector<float> input(3 * resize_img.rows * resize_img.cols, 0.0f);
     permute_rgb_to_chw(resize_img, input.data());
 
-    auto input_names = predictor->GetInputNames();
-    auto input_t = predictor->GetInputHandle(input_names[0]);
-    if (!input_t) {
-        log::error("Input is nullptr.");
-        return {};
-    }
-    input_t->Reshape({ 1, 3, resize_img.rows, resize_img.cols });
-    input_t->CopyFromCpu(input.data());
-    predictor->Run();
-
     std::vector<float> out_data;
-    auto output_names = predictor->GetOutputNames();
-    auto output_t = predictor->GetOutputHandle(output_names[0]);
-    if (!output_t) {
-        log::error("Output is nullptr.");
-        return {};
-    }
-    auto output_shape = output_t->shape();
-    int out_num = std::accumulate(output_shape.begin(), output_shape.end(), 1, std::multiplies<>());
+    std::vector<int> output_shape;
+    if (server) {
+        auto outputs = server->infer({ 3, resize_img.rows, resize_img.cols }, input.data(), 1);
+        if (outputs.empty() || outputs[0].data.empty()) {
+            return {};
+        }
+        output_shape = { 1 };
+        output_shape.insert(output_shape.end(), outputs[0].shape.begin(), outputs[0].shape.end());
+        out_data = std::move(outputs[0].data);
+    } else {
+        if (!predictor) {
+            log::error("Paddle text detector is not initialized.");
+            return {};
+        }
+        auto input_names = predictor->GetInputNames();
+        auto input_t = predictor->GetInputHandle(input_names[0]);
+        if (!input_t) {
+            log::error("Input is nullptr.");
+            return {};
+        }
+        input_t->Reshape({ 1, 3, resize_img.rows, resize_img.cols });
+        input_t->CopyFromCpu(input.data());
+        predictor->Run();
+
+        auto output_names = predictor->GetOutputNames();
+        auto output_t = predictor->GetOutputHandle(output_names[0]);
+        if (!output_t) {
+            log::error("Output is nullptr.");
+            return {};
+        }
+        output_shape = output_t->shape();
+        int out_num = std::accumulate(output_shape.begin(), output_shape.end(), 1, std::multiplies<>());
 
-    out_data.resize(out_num);
-    output_t->CopyToCpu(out_data.data());
+        out_data.resize(out_num);
+        output_t->CopyToCpu(out_data.data());
+    }
 
     int n2 = output_shape[2];
     int n3 = output_shape[3];
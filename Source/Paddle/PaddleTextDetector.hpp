@@ -6,6 +6,8 @@
 #include "Image.hpp"
 #include "TextDetection.hpp"
 #include "Config.hpp"
+#include "PaddleInferenceServer.hpp"
+#include "PaddleModelRegistry.hpp"
 #include "opencv2/imgproc.hpp"
 
 namespace frog {
@@ -13,13 +15,18 @@ namespace frog {
 class PaddleTextDetector : public TextDetector {
 public:
 
-    PaddleTextDetector(const PaddleTextDetectorConfig& config);
+    // If an inference server is given, detection runs through it instead of a predictor owned by this detector.
+    // Otherwise, the predictor is cloned from the model registry if given, so that the weights are shared.
+    PaddleTextDetector(const PaddleTextDetectorConfig& config, PaddleInferenceServer* server = nullptr, PaddleModelRegistry* models = nullptr);
+
+    static std::shared_ptr<paddle_infer::Predictor> createPredictor(const PaddleTextDetectorConfig& config, int mathThreadCount);
 
     std::vector<Quad> detect(PIX* image, const TextDetectionSettings& settings) const override;
 
 private:
 
     std::shared_ptr<paddle_infer::Predictor> predictor;
+    PaddleInferenceServer* server{};
 
 };
 
@@ -0,0 +1,341 @@
+#include "PaddleTextRecognizer.hpp"
+#include "Preprocessing.hpp"
+#include "utility.hpp"
+#include "Core/Log.hpp"
+#include "opencv2/imgproc.hpp"
+
+namespace frog {
+
+static constexpr int recognitionChannels{ 3 };
+static constexpr int recognitionHeight{ 48 };
+static constexpr int recognitionMinWidth{ 320 };
+
+// Batch widths are rounded up to a multiple of this, so the predictor sees a small set of input shapes.
+static constexpr int recognitionWidthStep{ 32 };
+
+// A batch is closed when a line would be padded to more than this many times its own width.
+static constexpr float maxBatchAspectRatioSpread{ 1.5f };
+
+static float line_aspect_ratio(const cv::Mat& line) {
+    if (line.empty()) {
+        return 0.0f;
+    }
+    return static_cast<float>(line.cols) / static_cast<float>(line.rows);
+}
+
+// Lines narrower than the minimum width are padded to it anyway, so they all compare equal.
+static float effective_aspect_ratio(float aspectRatio) {
+    return std::max(aspectRatio, static_cast<float>(recognitionMinWidth) / static_cast<float>(recognitionHeight));
+}
+
+static int get_batch_width(float maxAspectRatio) {
+    const auto width = static_cast<int>(std::ceil(static_cast<float>(recognitionHeight) * effective_aspect_ratio(maxAspectRatio)));
+    return (width + recognitionWidthStep - 1) / recognitionWidthStep * recognitionWidthStep;
+}
+
+std::shared_ptr<paddle_infer::Predictor> PaddleTextRecognizer::createPredictor(const PaddleTextRecognizerConfig& config, int mathThreadCount) {
+    if (!std::filesystem::exists(config.model)) {
+        log::error("Unable to find recognition model at configured path: {}", config.model);
+        return nullptr;
+    }
+    const auto model_directory = path_to_string(config.model);
+    paddle_infer::Config paddleConfig;
+    paddleConfig.SetModel(model_directory + "/inference.pdmodel", model_directory + "/inference.pdiparams");
+    paddleConfig.DisableGpu();
+    paddleConfig.EnableMKLDNN();
+    paddleConfig.SetMkldnnCacheCapacity(10);
+    paddleConfig.SetCpuMathLibraryNumThreads(mathThreadCount);
+    paddleConfig.pass_builder()->DeletePass("matmul_transpose_reshape_fuse_pass");
+    paddleConfig.SwitchUseFeedFetchOps(false);
+    paddleConfig.SwitchSpecifyInputNames(true);
+    paddleConfig.SwitchIrOptim(true);
+    paddleConfig.EnableMemoryOptim();
+#ifndef FROG_DEBUG_LOG_PADDLE
+    paddleConfig.DisableGlogInfo();
+#endif
+    return paddle_infer::CreatePredictor(paddleConfig);
+}
+
+PaddleTextRecognizer::PaddleTextRecognizer(const PaddleTextRecognizerConfig& config, PaddleInferenceServer* server_, PaddleModelRegistry* models) : server{ server_ } {
+    if (!std::filesystem::exists(config.labels)) {
+        log::error("Unable to find recognition labels at configured path: {}", config.labels);
+        return;
+    }
+    labels = Utility::ReadDict(path_to_string(config.labels));
+    labels.insert(labels.begin(), "#"); // Blank label for CTC.
+    labels.emplace_back(" ");
+    batchSize = std::max(config.batchSize, 1);
+    if (server) {
+        return;
+    }
+    log::info("Initializing Paddle text recognizer ({})", config.model);
+    if (models) {
+        predictor = models->clone(config.model, 1, [&config] {
+            return createPredictor(config, 1);
+        });
+    } else {
+        predictor = createPredictor(config, 1);
+    }
+    if (!predictor) {
+        return;
+    }
+
+    const auto input_names = predictor->GetInputNames();
+    if (input_names.empty()) {
+        log::error("Input names are empty.");
+        return;
+    }
+    inputTensor = predictor->GetInputHandle(input_names[0]);
+    const auto output_names = predictor->GetOutputNames();
+    if (output_names.empty()) {
+        log::error("Output names are empty.");
+        return;
+    }
+    outputTensor = predictor->GetOutputHandle(output_names[0]);
+}
+
+void PaddleTextRecognizer::recognizeBatch(const std::vector<cv::Mat>& lines, std::span<const std::size_t> lineIndices, std::vector<DecodedLine>& decodedLines) const {
+    const std::vector<float> mean{ 0.5f, 0.5f, 0.5f };
+    const std::vector<float> scale{ 1.0f / 0.5f, 1.0f / 0.5f, 1.0f / 0.5f };
+
+    // Indices are sorted by aspect ratio, so the last line is the widest.
+    const auto batch_count = static_cast<int>(lineIndices.size());
+    const auto batch_width = get_batch_width(line_aspect_ratio(lines[lineIndices.back()]));
+    const auto channel_size = static_cast<std::size_t>(recognitionHeight) * batch_width;
+    const auto input_size = recognitionChannels * channel_size;
+    inputBuffer.assign(static_cast<std::size_t>(batch_count) * input_size, 0.0f);
+    std::vector<int> content_widths(batch_count);
+    for (int i{ 0 }; i < batch_count; i++) {
+        const auto& line = lines[lineIndices[i]];
+        const auto resize_width = std::clamp(static_cast<int>(std::ceil(static_cast<float>(recognitionHeight) * line_aspect_ratio(line))), 1, batch_width);
+        content_widths[i] = resize_width;
+        cv::Mat resize_img;
+        cv::resize(line, resize_img, cv::Size(resize_width, recognitionHeight), 0.0f, 0.0f, cv::INTER_LINEAR);
+        normalize(&resize_img, mean, scale, true);
+
+        // Write each channel into the left part of its plane. The rest stays zero as padding.
+        float* input = inputBuffer.data() + static_cast<std::size_t>(i) * input_size;
+        for (int channel{ 0 }; channel < recognitionChannels; channel++) {
+            cv::Mat plane{ recognitionHeight, resize_width, CV_32FC1, input + channel * channel_size, static_cast<std::size_t>(batch_width) * sizeof(float) };
+            cv::extractChannel(resize_img, plane, channel);
+        }
+    }
+
+    int timesteps{};
+    int label_count{};
+    if (server) {
+        const auto outputs = server->infer({ recognitionChannels, recognitionHeight, batch_width }, inputBuffer.data(), batch_count);
+        if (outputs.empty() || outputs[0].shape.size() != 2) {
+            return;
+        }
+        timesteps = outputs[0].shape[0];
+        label_count = outputs[0].shape[1];
+        const auto output_size = static_cast<std::size_t>(timesteps) * label_count;
+        outputBuffer.resize(static_cast<std::size_t>(batch_count) * output_size);
+        for (int i{ 0 }; i < batch_count; i++) {
+            if (outputs[i].data.size() != output_size) {
+                return;
+            }
+            std::ranges::copy(outputs[i].data, outputBuffer.begin() + static_cast<std::ptrdiff_t>(i * output_size));
+        }
+    } else {
+        inputTensor->Reshape({ batch_count, recognitionChannels, recognitionHeight, batch_width });
+        inputTensor->CopyFromCpu(inputBuffer.data());
+        if (!predictor->Run()) {
+            log::error("Failed to run text recognition model.");
+            return;
+        }
+
+        const auto predict_shape = outputTensor->shape();
+        if (predict_shape.size() != 3) {
+            return;
+        }
+        const int out_num = std::accumulate(predict_shape.begin(), predict_shape.end(), 1, std::multiplies<>());
+        outputBuffer.resize(out_num);
+        outputTensor->CopyToCpu(outputBuffer.data());
+        timesteps = predict_shape[1];
+        label_count = predict_shape[2];
+    }
+
+    // CTC decode, keeping the timestep of each character to place words and symbols.
+    for (int i{ 0 }; i < batch_count; i++) {
+        auto& decodedLine = decodedLines[lineIndices[i]];
+        decodedLine.timesteps = timesteps;
+        decodedLine.inputWidth = static_cast<float>(batch_width);
+        decodedLine.contentWidth = static_cast<float>(content_widths[i]);
+        std::size_t last_label{};
+        for (int timestep{ 0 }; timestep < timesteps; timestep++) {
+            const auto begin = outputBuffer.begin() + (static_cast<std::ptrdiff_t>(i) * timesteps + timestep) * label_count;
+            const auto best = std::max_element(begin, begin + label_count);
+            const auto label = static_cast<std::size_t>(std::distance(begin, best));
+            if (label > 0 && label < labels.size() && !(timestep > 0 && label == last_label)) {
+                decodedLine.characters.emplace_back(DecodedCharacter{ label, timestep, *best });
+            }
+            last_label = label;
+        }
+    }
+}
+
+Line& PaddleTextRecognizer::addLine(Document& document, const DecodedLine& decodedLine, const Quad& quad, int lineWidth, bool rotated180) const {
+    const auto quadLeft = static_cast<int>(quad.left());
+    const auto quadTop = static_cast<int>(quad.top());
+    const auto quadHeight = static_cast<int>(quad.height());
+
+    // Maps a timestep boundary to a horizontal offset in the page.
+    const auto timestepToPixels = decodedLine.inputWidth / static_cast<float>(decodedLine.timesteps) * static_cast<float>(lineWidth) / decodedLine.contentWidth;
+    const auto toPageX = [&](int timestep) {
+        const auto x = std::clamp(static_cast<int>(std::round(static_cast<float>(timestep) * timestepToPixels)), 0, lineWidth);
+        return quadLeft + (rotated180 ? lineWidth - x : x);
+    };
+    const auto setHorizontalBounds = [&](auto& box, int beginTimestep, int endTimestep) {
+        const auto x1 = toPageX(beginTimestep);
+        const auto x2 = toPageX(endTimestep);
+        box.x = std::min(x1, x2);
+        box.width = std::max(std::abs(x2 - x1), 1);
+        box.y = quadTop;
+        box.height = quadHeight;
+    };
+
+    auto& line = document.addLine();
+    line.x = quadLeft;
+    line.y = quadTop;
+    line.width = static_cast<int>(quad.width());
+    line.height = quadHeight;
+
+    float lineConfidence{};
+    const auto& characters = decodedLine.characters;
+    std::size_t wordBegin{};
+    while (wordBegin < characters.size()) {
+        if (labels[characters[wordBegin].label] == " ") {
+            lineConfidence += characters[wordBegin].confidence;
+            wordBegin++;
+            continue;
+        }
+        auto wordEnd = wordBegin;
+        while (wordEnd < characters.size() && labels[characters[wordEnd].label] != " ") {
+            wordEnd++;
+        }
+        auto& word = document.addWord();
+        // The symbol texts are added right after each other, so the word text is the span that covers them.
+        word.text = document.addText({});
+        float wordConfidence{};
+        for (auto characterIndex = wordBegin; characterIndex < wordEnd; characterIndex++) {
+            const auto& character = characters[characterIndex];
+            const auto endTimestep = characterIndex + 1 < wordEnd ? characters[characterIndex + 1].timestep : character.timestep + 1;
+            auto& symbol = document.addSymbol();
+            setHorizontalBounds(symbol, character.timestep, endTimestep);
+            symbol.text = document.addText(labels[character.label]);
+            symbol.confidence = { character.confidence, Confidence::Format::normalized };
+            word.text.size += symbol.text.size;
+            wordConfidence += character.confidence;
+        }
+        lineConfidence += wordConfidence;
+        setHorizontalBounds(word, characters[wordBegin].timestep, characters[wordEnd - 1].timestep + 1);
+        word.confidence = { wordConfidence / static_cast<float>(wordEnd - wordBegin), Confidence::Format::normalized };
+        wordBegin = wordEnd;
+    }
+    if (!characters.empty()) {
+        lineConfidence /= static_cast<float>(characters.size());
+    }
+    line.confidence = { lineConfidence, Confidence::Format::normalized };
+    return line;
+}
+
+Document PaddleTextRecognizer::recognize(PIX* image, const std::vector<Quad>& quads, std::vector<int> angles, const TextRecognitionSettings& settings) const {
+    if (labels.empty() || (!server && (!inputTensor || !outputTensor))) {
+        log::error("Paddle text recognizer is not initialized.");
+        return {};
+    }
+
+    // Crop, deskew and rotate to match predicted angle in one pass.
+    std::vector<cv::Mat> lines;
+    lines.reserve(quads.size());
+    for (std::size_t quadIndex{}; quadIndex < quads.size(); quadIndex++) {
+        auto pix = crop_and_deskew_quad(image, quads[quadIndex], angles[quadIndex] == 180);
+        if (!pix) {
+            lines.emplace_back();
+            continue;
+        }
+        auto line = pix_to_mat(pix);
+        pixDestroy(&pix);
+        if (line.channels() == 1) {
+            cv::cvtColor(line, line, cv::COLOR_GRAY2BGR);
+        }
+        lines.emplace_back(std::move(line));
+    }
+
+    // Sort by aspect ratio, and close a batch when it is full or the next line is much wider than the first.
+    std::vector<std::size_t> lineIndices;
+    lineIndices.reserve(lines.size());
+    for (std::size_t lineIndex{}; lineIndex < lines.size(); lineIndex++) {
+        if (!lines[lineIndex].empty()) {
+            lineIndices.push_back(lineIndex);
+        }
+    }
+    std::ranges::stable_sort(lineIndices, [&lines](std::size_t a, std::size_t b) {
+        return line_aspect_ratio(lines[a]) < line_aspect_ratio(lines[b]);
+    });
+    std::vector<DecodedLine> decodedLines(lines.size());
+    std::size_t batchBegin{};
+    while (batchBegin < lineIndices.size()) {
+        const auto firstAspectRatio = effective_aspect_ratio(line_aspect_ratio(lines[lineIndices[batchBegin]]));
+        auto batchEnd = batchBegin + 1;
+        while (batchEnd < lineIndices.size() && batchEnd - batchBegin < static_cast<std::size_t>(batchSize)) {
+            if (effective_aspect_ratio(line_aspect_ratio(lines[lineIndices[batchEnd]])) > firstAspectRatio * maxBatchAspectRatioSpread) {
+                break;
+            }
+            batchEnd++;
+        }
+        recognizeBatch(lines, std::span{ lineIndices }.subspan(batchBegin, batchEnd - batchBegin), decodedLines);
+        batchBegin = batchEnd;
+    }
+
+    // Build document in the order of the quads.
+    Document document;
+    float confidence{};
+    int wordCount{};
+    for (std::size_t quadIndex{}; quadIndex < quads.size(); quadIndex++) {
+        const auto& decodedLine = decodedLines[quadIndex];
+        if (decodedLine.characters.empty()) {
+            continue;
+        }
+        const auto hasWords = std::ranges::any_of(decodedLine.characters, [this](const DecodedCharacter& character) {
+            return labels[character.label] != " ";
+        });
+        if (!hasWords) {
+            continue;
+        }
+        const auto& quad = quads[quadIndex];
+        auto& block = document.addBlock();
+        auto& paragraph = document.addParagraph();
+        const auto& line = addLine(document, decodedLine, quad, lines[quadIndex].cols, angles[quadIndex] == 180);
+        for (const auto& word : document.words(line)) {
+            confidence += word.confidence.getNormalized();
+            wordCount++;
+        }
+        paragraph.x = line.x;
+        paragraph.y = line.y;
+        paragraph.width = line.width;
+        paragraph.height = line.height;
+        paragraph.angleInDegrees = quad.bottomRightToLeftAngle() * 180.0f / M_PIf;
+        paragraph.confidence = line.confidence;
+        block.x = paragraph.x;
+        block.y = paragraph.y;
+        block.width = paragraph.width;
+        block.height = paragraph.height;
+        block.confidence = paragraph.confidence;
+    }
+    if (wordCount > 0) {
+        confidence /= static_cast<float>(wordCount);
+    }
+    document.confidence = { confidence, Confidence::Format::normalized };
+
+    std::size_t rotatedCount{};
+    for (const auto angle : angles) {
+        rotatedCount += angle == 180 ? 1 : 0;
+    }
+    document.rotationInDegrees = rotatedCount > angles.size() / 2 ? 180.0f : 0.0f;
+    return document;
+}
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "paddle_api.h"
+#include "paddle_inference_api.h"
+
+#include "TextRecognizer.hpp"
+#include "Config.hpp"
+#include "Image.hpp"
+#include "PaddleInferenceServer.hpp"
+#include "PaddleModelRegistry.hpp"
+
+#include <span>
+
+namespace frog {
+
+// Recognizes text lines with a Paddle CTC model.
+// Lines are sorted by aspect ratio and recognized in batches of similar width, to keep padding low.
+class PaddleTextRecognizer : public TextRecognizer {
+public:
+
+    // If an inference server is given, recognition runs through it instead of a predictor owned by this recognizer.
+    // Otherwise, the predictor is cloned from the model registry if given, so that the weights are shared.
+    PaddleTextRecognizer(const PaddleTextRecognizerConfig& config, PaddleInferenceServer* server = nullptr, PaddleModelRegistry* models = nullptr);
+
+    static std::shared_ptr<paddle_infer::Predictor> createPredictor(const PaddleTextRecognizerConfig& config, int mathThreadCount);
+
+    Document recognize(PIX* image, const std::vector<Quad>& quads, std::vector<int> angles, const TextRecognitionSettings& settings) const override;
+
+private:
+
+    struct DecodedCharacter {
+        std::size_t label{};
+        int timestep{};
+        float confidence{};
+    };
+
+    struct DecodedLine {
+        std::vector<DecodedCharacter> characters;
+        int timesteps{};
+        float inputWidth{}; // Width of the line in the input tensor, including padding.
+        float contentWidth{}; // Width of the resized line in the input tensor, excluding padding.
+    };
+
+    void recognizeBatch(const std::vector<cv::Mat>& lines, std::span<const std::size_t> lineIndices, std::vector<DecodedLine>& decodedLines) const;
+
+    // Adds the line and its words to the last paragraph of the document.
+    Line& addLine(Document& document, const DecodedLine& decodedLine, const Quad& quad, int lineWidth, bool rotated180) const;
+
+    std::shared_ptr<paddle_infer::Predictor> predictor;
+    std::unique_ptr<paddle_infer::Tensor> inputTensor;
+    std::unique_ptr<paddle_infer::Tensor> outputTensor;
+    PaddleInferenceServer* server{};
+    std::vector<std::string> labels;
+    mutable std::vector<float> inputBuffer;
+    mutable std::vector<float> outputBuffer;
+    int batchSize{ 1 };
+
+};
+
+}
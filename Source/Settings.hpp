@@ -2,6 +2,9 @@
 
 #include "Core/Log.hpp"
 
+#include <algorithm>
+#include <cctype>
+
 namespace frog {
 
 enum class PageSegmentation { automatic, sparse, block, line, word };
@@ -46,7 +49,9 @@ struct TextRecognitionSettings {
     float sauvolaKFactor{ defaultSauvolaKFactor };
     PageSegmentation pageSegmentation{ PageSegmentation::block };
     std::string characterWhitelist;
+    std::string language; // Tesseract dataset, e.g. "nor+eng". Empty means the profile's dataset.
     std::optional<float> minWordConfidence;
+    int maxEngineCount{ 1 }; // Engines the lines of a page may be split between. Set by the task pipeline, not the task settings.
 };
 
 struct ResultSettings {
@@ -64,6 +69,7 @@ struct Settings {
 
     ResultSettings result;
     bool overwriteOutput{};
+    bool urgent{}; // Split the page between several engines in latency mode, even if the task queue is long.
 
     Settings() = default;
 
@@ -106,6 +112,9 @@ struct Settings {
             if (!recognition.characterWhitelist.empty()) {
                 csv += fmt::format("CharacterWhitelist={},", recognition.characterWhitelist);
             }
+            if (!recognition.language.empty()) {
+                csv += fmt::format("Language={},", recognition.language);
+            }
         }
         csv += fmt::format("TextRecognizer={},", recognition.textRecognizer);
 
@@ -121,6 +130,9 @@ struct Settings {
 
         // Misc
         csv += fmt::format("OverwriteOutput={},", overwriteOutput ? "true" : "false");
+        if (urgent) {
+            csv += "Urgent=true,";
+        }
 
         if (csv.ends_with(",")) {
             csv.pop_back();
@@ -172,6 +184,16 @@ struct Settings {
             }
         } else if (key == "CharacterWhitelist") {
             recognition.characterWhitelist = value;
+        } else if (key == "Language") {
+            // Dataset names are used to find traineddata files, so only allow what they are made of.
+            const auto isDatasetCharacter = [](char character) {
+                return std::isalnum(static_cast<unsigned char>(character)) || character == '_' || character == '-' || character == '+';
+            };
+            if (std::ranges::all_of(value, isDatasetCharacter)) {
+                recognition.language = value;
+            } else {
+                log::warning("Failed to read setting: {} = {}", key, value);
+            }
         } else if (key == "TextDetector") {
             detection.textDetector = value;
         } else if (key == "TextRecognizer") {
@@ -192,6 +214,8 @@ struct Settings {
             }
         } else if (key == "OverwriteOutput") {
             overwriteOutput = value == "true";
+        } else if (key == "Urgent") {
+            urgent = value == "true";
         } else if (key == "Result.SavePageAngle") {
             result.savePageAngle = value == "true";
         } else {
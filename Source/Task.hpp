@@ -8,6 +8,7 @@ struct Task {
     std::int64_t taskId{};
     std::string inputPath;
     std::string outputPath;
+    std::int32_t priority{};
     std::string customData1;
     std::int64_t customData2{};
     std::string settingsCsv; // setting=value CSV
@@ -0,0 +1,143 @@
+#include "TaskPipeline.hpp"
+
+namespace frog {
+
+static std::size_t get_stage_queue_capacity(const Config& config) {
+    if (config.pipeline.has_value() && config.pipeline->queueCapacity > 0) {
+        return static_cast<std::size_t>(config.pipeline->queueCapacity);
+    }
+    return static_cast<std::size_t>(std::max(config.maxThreadCount, 1));
+}
+
+static std::size_t get_memory_budget_bytes(const Config& config) {
+    if (config.readAheadMemoryBudgetMegabytes <= 0) {
+        return std::numeric_limits<std::size_t>::max();
+    }
+    return static_cast<std::size_t>(config.readAheadMemoryBudgetMegabytes) * 1024 * 1024;
+}
+
+static void join_threads(std::vector<std::thread>& threads) {
+    for (auto& thread : threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads.clear();
+}
+
+TaskPipeline::TaskPipeline(const Config& config, const Profile& profile, BlockingQueue<Task>& taskQueue_)
+    : taskQueue{ taskQueue_ },
+      loadedTasks{ get_stage_queue_capacity(config) },
+      completedTasks{ get_stage_queue_capacity(config) },
+      memoryBudget{ get_memory_budget_bytes(config) },
+      sharedResources{ config, profile },
+      maxEnginesPerPage{ profile.tesseract.has_value() ? profile.tesseract->maxEnginesPerPage : 1 },
+      latencyModeMaxQueuedTasks{ static_cast<std::size_t>(std::max(config.latencyModeMaxQueuedTasks, 0)) } {
+    if (maxEnginesPerPage > 1) {
+        log::info("Latency mode: up to {} Tesseract engines per page while at most {} tasks are waiting", maxEnginesPerPage, latencyModeMaxQueuedTasks);
+    }
+    for (int i{ 0 }; i < config.maxThreadCount; i++) {
+        processors.emplace_back(std::make_unique<TaskProcessor>(profile, &sharedResources));
+    }
+    if (!config.pipeline.has_value() && config.readAheadTaskCount > 0) {
+        log::info("Reading ahead {} tasks per processing thread", config.readAheadTaskCount);
+        for (auto& processor : processors) {
+            auto& readAheadTasks = *readAheadQueues.emplace_back(std::make_unique<BlockingQueue<LoadedTask>>(config.readAheadTaskCount));
+            loadThreads.emplace_back([this, &readAheadTasks] {
+                runLoadStage(readAheadTasks);
+            });
+            processThreads.emplace_back([this, &processor, &readAheadTasks] {
+                runReadAheadTasks(*processor, readAheadTasks);
+            });
+        }
+        return;
+    }
+    if (!config.pipeline.has_value()) {
+        for (auto& processor : processors) {
+            processThreads.emplace_back([this, &processor] {
+                runTasks(*processor);
+            });
+        }
+        return;
+    }
+    log::info("Running tasks in pipeline: {} load, {} process, {} save threads", config.pipeline->loadThreadCount, processors.size(), config.pipeline->saveThreadCount);
+    for (int i{ 0 }; i < config.pipeline->loadThreadCount; i++) {
+        loadThreads.emplace_back([this] {
+            runLoadStage(loadedTasks);
+        });
+    }
+    for (auto& processor : processors) {
+        processThreads.emplace_back([this, &processor] {
+            runProcessStage(*processor);
+        });
+    }
+    for (int i{ 0 }; i < config.pipeline->saveThreadCount; i++) {
+        saveThreads.emplace_back([this] {
+            runSaveStage();
+        });
+    }
+}
+
+TaskPipeline::~TaskPipeline() {
+    // Each stage stops once the previous one is done and its queue is drained.
+    join_threads(loadThreads);
+    loadedTasks.close();
+    for (auto& readAheadTasks : readAheadQueues) {
+        readAheadTasks->close();
+    }
+    join_threads(processThreads);
+    completedTasks.close();
+    join_threads(saveThreads);
+}
+
+std::size_t TaskPipeline::getProcessorCount() const {
+    return processors.size();
+}
+
+void TaskPipeline::runTasks(TaskProcessor& processor) {
+    while (auto task = taskQueue.pop()) {
+        if (auto loadedTask = load_task(task.value())) {
+            save_task(processor.processTask(loadedTask.value(), getRecognitionEngineCount(loadedTask.value())));
+        }
+    }
+}
+
+void TaskPipeline::runReadAheadTasks(TaskProcessor& processor, BlockingQueue<LoadedTask>& readAheadTasks) {
+    while (auto loadedTask = readAheadTasks.pop()) {
+        loadedTask->releaseReservedMemory();
+        save_task(processor.processTask(loadedTask.value(), getRecognitionEngineCount(loadedTask.value())));
+    }
+}
+
+void TaskPipeline::runLoadStage(BlockingQueue<LoadedTask>& destination) {
+    while (auto task = taskQueue.pop()) {
+        if (auto loadedTask = load_task(task.value(), &memoryBudget)) {
+            destination.push(std::move(loadedTask.value()));
+        }
+    }
+}
+
+void TaskPipeline::runProcessStage(TaskProcessor& processor) {
+    while (auto loadedTask = loadedTasks.pop()) {
+        loadedTask->releaseReservedMemory();
+        completedTasks.push(processor.processTask(loadedTask.value(), getRecognitionEngineCount(loadedTask.value())));
+    }
+}
+
+void TaskPipeline::runSaveStage() {
+    while (auto completedTask = completedTasks.pop()) {
+        save_task(completedTask.value());
+    }
+}
+
+int TaskPipeline::getRecognitionEngineCount(const LoadedTask& task) const {
+    if (maxEnginesPerPage <= 1) {
+        return 1;
+    }
+    if (task.settings.urgent || taskQueue.size() + loadedTasks.size() <= latencyModeMaxQueuedTasks) {
+        return maxEnginesPerPage;
+    }
+    return 1;
+}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "TaskProcessor.hpp"
+#include "Core/BlockingQueue.hpp"
+#include "Core/MemoryBudget.hpp"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace frog {
+
+// Runs tasks from the shared task queue on long-lived worker threads.
+//
+// Without a pipeline configuration, each processing thread runs every stage of a task in sequence. If read-ahead
+// is enabled, each processing thread also gets a thread that reads and decodes its next few tasks in the background.
+// With a pipeline configuration, reading and decoding input, processing, and writing output run on separate thread pools,
+// connected by bounded queues, so that network I/O overlaps with text detection and recognition.
+//
+// In latency mode, the lines of a page are split between several Tesseract engines. It is used while few tasks are waiting,
+// so that otherwise idle engines help finish the current pages sooner, and for tasks marked as urgent.
+class TaskPipeline {
+public:
+
+    TaskPipeline(const Config& config, const Profile& profile, BlockingQueue<Task>& taskQueue);
+    TaskPipeline(const TaskPipeline&) = delete;
+    TaskPipeline(TaskPipeline&&) = delete;
+
+    // The task queue must be closed first. Every queued task is finished before this returns.
+    ~TaskPipeline();
+
+    TaskPipeline& operator=(const TaskPipeline&) = delete;
+    TaskPipeline& operator=(TaskPipeline&&) = delete;
+
+    [[nodiscard]] std::size_t getProcessorCount() const;
+
+private:
+
+    void runTasks(TaskProcessor& processor);
+    void runReadAheadTasks(TaskProcessor& processor, BlockingQueue<LoadedTask>& readAheadTasks);
+    void runLoadStage(BlockingQueue<LoadedTask>& destination);
+    void runProcessStage(TaskProcessor& processor);
+    void runSaveStage();
+    [[nodiscard]] int getRecognitionEngineCount(const LoadedTask& task) const;
+
+    BlockingQueue<Task>& taskQueue;
+    BlockingQueue<LoadedTask> loadedTasks;
+    BlockingQueue<CompletedTask> completedTasks;
+    std::vector<std::unique_ptr<BlockingQueue<LoadedTask>>> readAheadQueues;
+    MemoryBudget memoryBudget;
+    SharedTaskResources sharedResources;
+    const int maxEnginesPerPage;
+    const std::size_t latencyModeMaxQueuedTasks;
+
+    std::vector<std::unique_ptr<TaskProcessor>> processors;
+    std::vector<std::thread> loadThreads;
+    std::vector<std::thread> processThreads;
+    std::vector<std::thread> saveThreads;
+
+};
+
+}
@@ -1,5 +1,6 @@
 #include "TaskProcessor.hpp"
 #include "Core/SambaClient.hpp"
+#include "Core/QuadGrid.hpp"
 #include "Application.hpp"
 
 namespace frog {
@@ -63,6 +64,9 @@ static alto::Processing create_alto_text_recognition_processing(const TextRecogn
         if (!settings.characterWhitelist.empty()) {
             processing.processingStepSettings.emplace_back(fmt::format("CharacterWhitelist: {}", settings.characterWhitelist));
         }
+        if (!settings.language.empty()) {
+            processing.processingStepSettings.emplace_back(fmt::format("Language: {}", settings.language));
+        }
     }
     if (settings.minWordConfidence.has_value()) {
         processing.processingStepSettings.emplace_back(fmt::format("MinWordConfidence: {}", settings.minWordConfidence.value()));
@@ -87,98 +91,112 @@ static std::vector<alto::Processing> create_alto_processings(const Settings& set
     return processings;
 }
 
-TaskProcessor::TaskProcessor(const Profile& profile) {
+SharedTaskResources::SharedTaskResources(const Config& config, const Profile& profile) : paddleInferenceServers{ profile, &paddleModels } {
+    if (profile.tesseract.has_value()) {
+        const auto engineCount = profile.tesseract->engineCount > 0 ? profile.tesseract->engineCount : config.maxThreadCount;
+        tesseractEngines = std::make_unique<TesseractEnginePool>(profile.tesseract.value(), engineCount);
+    }
+    if (profile.huginMuninTextDetector.has_value()) {
+        huginMuninTextDetectorWorker = HuginMuninTextDetector::createWorker(profile.huginMuninTextDetector.value(), profile.huginMuninTextDetector->workerCount);
+    }
+    if (profile.huginMuninTextRecognizer.has_value()) {
+        huginMuninTextRecognizerWorker = HuginMuninTextRecognizer::createWorker(profile.huginMuninTextRecognizer.value(), profile.huginMuninTextRecognizer->workerCount);
+    }
+}
+
+TaskProcessor::TaskProcessor(const Profile& profile, SharedTaskResources* sharedResources) {
+    const auto paddleModels = sharedResources ? &sharedResources->paddleModels : nullptr;
+    const auto paddleInferenceServers = sharedResources ? &sharedResources->paddleInferenceServers : nullptr;
     integratedTextDetector = std::make_unique<IntegratedTextDetector>();
     if (profile.paddleTextDetector.has_value()) {
-        paddleTextDetector = std::make_unique<PaddleTextDetector>(profile.paddleTextDetector.value());
+        const auto server = paddleInferenceServers ? paddleInferenceServers->textDetector.get() : nullptr;
+        paddleTextDetector = std::make_unique<PaddleTextDetector>(profile.paddleTextDetector.value(), server, paddleModels);
     }
     if (profile.tesseract.has_value()) {
-        tesseractTextRecognizer = std::make_unique<TesseractTextRecognizer>(profile.tesseract.value());
+        auto tesseractEngines = sharedResources ? sharedResources->tesseractEngines.get() : nullptr;
+        if (!tesseractEngines) {
+            ownTesseractEngines = std::make_unique<TesseractEnginePool>(profile.tesseract.value(), 1);
+            tesseractEngines = ownTesseractEngines.get();
+        }
+        tesseractTextRecognizer = std::make_unique<TesseractTextRecognizer>(*tesseractEngines);
+    }
+    if (profile.paddleTextRecognizer.has_value()) {
+        const auto server = paddleInferenceServers ? paddleInferenceServers->textRecognizer.get() : nullptr;
+        paddleTextRecognizer = std::make_unique<PaddleTextRecognizer>(profile.paddleTextRecognizer.value(), server, paddleModels);
     }
     if (profile.paddleTextOrientationClassifier.has_value()) {
-        paddleTextAngleClassifier = std::make_unique<PaddleTextAngleClassifier>(profile.paddleTextOrientationClassifier.value());
+        const auto server = paddleInferenceServers ? paddleInferenceServers->textAngleClassifier.get() : nullptr;
+        paddleTextAngleClassifier = std::make_unique<PaddleTextAngleClassifier>(profile.paddleTextOrientationClassifier.value(), server, paddleModels);
     }
     if (profile.huginMuninTextRecognizer.has_value()) {
-        huginMuninTextRecognizer = std::make_unique<HuginMuninTextRecognizer>(profile.huginMuninTextRecognizer.value());
+        const auto worker = sharedResources ? sharedResources->huginMuninTextRecognizerWorker.get() : nullptr;
+        huginMuninTextRecognizer = std::make_unique<HuginMuninTextRecognizer>(profile.huginMuninTextRecognizer.value(), worker);
     }
     if (profile.huginMuninTextDetector.has_value()) {
-        huginMuninTextDetector = std::make_unique<HuginMuninTextDetector>(profile.huginMuninTextDetector.value());
+        const auto worker = sharedResources ? sharedResources->huginMuninTextDetectorWorker.get() : nullptr;
+        huginMuninTextDetector = std::make_unique<HuginMuninTextDetector>(profile.huginMuninTextDetector.value(), worker);
     }
 }
 
-TaskProcessor::~TaskProcessor() {
-    if (thread.joinable()) {
-        thread.join();
-    }
+LoadedTask::LoadedTask(Task task_, Settings settings_, PIX* image_, MemoryBudget* memoryBudget_, std::size_t reservedMemory_)
+    : task{ std::move(task_) }, settings{ std::move(settings_) }, image{ image_ }, memoryBudget{ memoryBudget_ }, reservedMemory{ reservedMemory_ } {
+
 }
 
-void TaskProcessor::pushTask(Task task) {
-    std::lock_guard lock{ taskMutex };
-    tasks.emplace_back(task);
-    remainingTaskCount++;
+LoadedTask::LoadedTask(LoadedTask&& that) noexcept
+    : task{ std::move(that.task) }, settings{ std::move(that.settings) }, image{ that.image }, memoryBudget{ that.memoryBudget }, reservedMemory{ that.reservedMemory } {
+    that.image = nullptr;
+    that.memoryBudget = nullptr;
+    that.reservedMemory = 0;
 }
 
-bool TaskProcessor::isFinished() const {
-    return finished;
+LoadedTask::~LoadedTask() {
+    if (image) {
+        pixDestroy(&image);
+    }
+    releaseReservedMemory();
 }
 
-void TaskProcessor::relaunch() {
-    if (!finished) {
-        log::error("Attempted to relaunch thread before joining with current one.");
-        return;
-    }
-    if (thread.joinable()) {
-        thread.join();
-    }
-    finished = false;
-    thread = std::thread{ [this] {
-        while (!finished) {
-            {
-                std::lock_guard lock{ taskMutex };
-                activeTask = tasks.front();
-                tasks.erase(tasks.begin());
-                remainingTaskCount--;
-            }
-            doTask(activeTask);
-            if (tasks.empty()) {
-                finished = true;
-            }
+LoadedTask& LoadedTask::operator=(LoadedTask&& that) noexcept {
+    if (this != &that) {
+        if (image) {
+            pixDestroy(&image);
         }
-    }};
+        releaseReservedMemory();
+        task = std::move(that.task);
+        settings = std::move(that.settings);
+        image = that.image;
+        memoryBudget = that.memoryBudget;
+        reservedMemory = that.reservedMemory;
+        that.image = nullptr;
+        that.memoryBudget = nullptr;
+        that.reservedMemory = 0;
+    }
+    return *this;
 }
 
-int TaskProcessor::getRemainingTaskCount() const {
-    return remainingTaskCount;
+void LoadedTask::releaseReservedMemory() {
+    if (memoryBudget) {
+        memoryBudget->release(reservedMemory);
+        memoryBudget = nullptr;
+        reservedMemory = 0;
+    }
 }
 
-std::vector<float> getQuadConfidences(const std::vector<Quad>& quads, const Document& document) {
-    std::vector<float> confidences;
-    confidences.reserve(quads.size());
-    for (const auto& quad : quads) {
-        float sumConfidence{};
-        float count{};
-        for (const auto& block : document.blocks) {
-            for (const auto& paragraph : block.paragraphs) {
-                for (const auto& line: paragraph.lines) {
-                    for (const auto& word: line.words) {
-                        const auto wordQuad = make_word_quad(word);
-                        if (quad.coverage(wordQuad) > 0.75f || wordQuad.coverage(quad) > 0.75f) {
-                            sumConfidence += word.confidence.getNormalized();
-                            count++;
-                        }
-                    }
-                }
-            }
-        }
-        confidences.push_back(sumConfidence / count);
+// Estimates the size of the decoded image from the file header, so memory can be reserved before decoding.
+static std::size_t estimate_decoded_image_size(l_int32 width, l_int32 height, l_int32 bitsPerSample, l_int32 samplesPerPixel) {
+    auto depth = bitsPerSample * samplesPerPixel;
+    if (samplesPerPixel >= 3) {
+        depth = 32; // Leptonica stores RGB(A) as 32 bits per pixel.
     }
-    return confidences;
+    const auto wordsPerLine = (static_cast<std::size_t>(width) * static_cast<std::size_t>(std::max(depth, 1)) + 31) / 32;
+    return wordsPerLine * 4 * static_cast<std::size_t>(height);
 }
 
-void TaskProcessor::doTask(const Task& task) {
+std::optional<LoadedTask> load_task(const Task& task, MemoryBudget* memoryBudget) {
     log::info("{}", task.inputPath);
 
-    const Settings settings{ task.settingsCsv };
+    Settings settings{ task.settingsCsv };
 
     // Pre-checks
     SambaClient* sambaClient{};
@@ -186,44 +204,131 @@ void TaskProcessor::doTask(const Task& task) {
         sambaClient = acquire_samba_client();
         if (!sambaClient) {
             log::error("Samba client not configured. Skipping task {}", task.inputPath);
-            return;
+            return std::nullopt;
         }
         if (!settings.overwriteOutput && sambaClient->exists(task.outputPath)) {
-            release_samba_client();
+            release_samba_client(sambaClient);
             log::warning("Output file already exists: %cyan{}", task.outputPath);
-            return;
+            return std::nullopt;
         }
         if (!sambaClient->exists(task.inputPath)) {
-            release_samba_client();
+            release_samba_client(sambaClient);
             log::error("Input file does not exist: %cyan{}", task.inputPath);
-            return;
+            return std::nullopt;
         }
     } else {
         if (!settings.overwriteOutput && std::filesystem::exists(task.outputPath)) {
             log::warning("Output file already exists: %cyan{}", task.outputPath);
-            return;
+            return std::nullopt;
         }
         if (!std::filesystem::exists(task.inputPath)) {
             log::error("Input file does not exist: %cyan{}", task.inputPath);
-            return;
+            return std::nullopt;
         }
     }
 
     // Initialize
+    l_int32 width{};
+    l_int32 height{};
+    l_int32 bitsPerSample{};
+    l_int32 samplesPerPixel{};
+    std::size_t reservedMemory{};
     PIX* image{};
     if (task.inputPath.starts_with("smb://")) {
         const auto data = sambaClient->readFile(task.inputPath);
-        release_samba_client();
+        release_samba_client(sambaClient);
         if (data) {
-            image = pixReadMem(reinterpret_cast<const l_uint8*>(data->data()), data->size());
+            const auto bytes = reinterpret_cast<const l_uint8*>(data->data());
+            if (memoryBudget && pixReadHeaderMem(bytes, data->size(), nullptr, &width, &height, &bitsPerSample, &samplesPerPixel, nullptr) == 0) {
+                reservedMemory = estimate_decoded_image_size(width, height, bitsPerSample, samplesPerPixel);
+                memoryBudget->reserve(reservedMemory);
+            }
+            image = pixReadMem(bytes, data->size());
         }
     } else {
+        if (memoryBudget && pixReadHeader(task.inputPath.c_str(), nullptr, &width, &height, &bitsPerSample, &samplesPerPixel, nullptr) == 0) {
+            reservedMemory = estimate_decoded_image_size(width, height, bitsPerSample, samplesPerPixel);
+            memoryBudget->reserve(reservedMemory);
+        }
         image = pixRead(task.inputPath.c_str());
     }
     if (!image) {
+        if (memoryBudget) {
+            memoryBudget->release(reservedMemory);
+        }
         log::error("Failed to load image: %cyan{}", task.inputPath);
-        return;
+        return std::nullopt;
+    }
+    return LoadedTask{ task, std::move(settings), image, memoryBudget, reservedMemory };
+}
+
+void save_task(const CompletedTask& task) {
+    if (task.task.outputPath.starts_with("smb://")) {
+        auto sambaClient = acquire_samba_client();
+        if (!sambaClient) {
+            log::error("Samba client not configured. Unable to save {}", task.task.outputPath);
+            return;
+        }
+        if (!sambaClient->writeFile(task.task.outputPath, task.altoXml)) {
+            log::error("Failed to write AltoXML file: {}", task.task.outputPath);
+        }
+        release_samba_client(sambaClient);
+    } else {
+        if (!write_file(task.task.outputPath, task.altoXml)) {
+            log::error("Failed to write AltoXML file: {}", task.task.outputPath);
+        }
     }
+}
+
+static std::vector<Quad> make_word_quads(std::span<const Word> words) {
+    std::vector<Quad> quads;
+    quads.reserve(words.size());
+    for (const auto& word : words) {
+        quads.push_back(make_word_quad(word));
+    }
+    return quads;
+}
+
+static void set_processing_refs(Document& document, std::string_view detector, std::string_view recognizer) {
+    const auto detectorRef = document.addText(detector);
+    const auto recognizerRef = document.addText(recognizer);
+    for (auto& block : document.blocks()) {
+        block.detector = detectorRef;
+        block.recognizer = recognizerRef;
+    }
+}
+
+// Two quads are taken to be the same area when either covers more than this much of the other.
+static constexpr float same_area_coverage{ 0.75f };
+
+std::vector<float> getQuadConfidences(const std::vector<Quad>& quads, const Document& document) {
+    const auto words = document.allWords();
+    const auto wordQuads = make_word_quads(words);
+    const QuadGrid wordGrid{ wordQuads };
+    std::vector<float> confidences;
+    confidences.reserve(quads.size());
+    for (const auto& quad : quads) {
+        float sumConfidence{};
+        float count{};
+        wordGrid.forEachCovering(quad, same_area_coverage, [&](std::size_t wordIndex) {
+            sumConfidence += words[wordIndex].confidence.getNormalized();
+            count++;
+        });
+        confidences.push_back(sumConfidence / count);
+    }
+    return confidences;
+}
+
+void TaskProcessor::doTask(const Task& task) {
+    if (auto loadedTask = load_task(task)) {
+        save_task(processTask(loadedTask.value()));
+    }
+}
+
+CompletedTask TaskProcessor::processTask(const LoadedTask& loadedTask, int maxRecognitionEngineCount) {
+    const auto& task = loadedTask.task;
+    const auto& settings = loadedTask.settings;
+    auto image = loadedTask.image;
 
     // Text Detection
     const auto* textDetector = getTextDetector(settings.detection.textDetector);
@@ -238,13 +343,12 @@ void TaskProcessor::doTask(const Task& task) {
     Document document;
     const auto textRecognitionDateTime = create_processing_date_time();
     if (const auto* textRecognizer = getTextRecognizer(settings.recognition.textRecognizer)) {
-        document = textRecognizer->recognize(image, quads, angles, settings.recognition);
+        auto recognitionSettings = settings.recognition;
+        recognitionSettings.maxEngineCount = maxRecognitionEngineCount;
+        document = textRecognizer->recognize(image, quads, angles, recognitionSettings);
     }
 
-    for (auto& block : document.blocks) {
-        block.detector = "processing_0";
-        block.recognizer = "processing_2";
-    }
+    set_processing_refs(document, "processing_0", "processing_2");
 
     // Additional Text Detection
     const auto textDetection2DateTime = create_processing_date_time();
@@ -270,68 +374,26 @@ void TaskProcessor::doTask(const Task& task) {
                 additionalAngles.resize(filteredQuads.size());
                 additionalDocument = additionalTextRecognizer->recognize(image, filteredQuads, additionalAngles, settings.additionalRecognition.value());
             }
-            for (auto& block: additionalDocument.blocks) {
-                block.detector = "processing_3";
-                block.recognizer = "processing_4";
-            }
+            set_processing_refs(additionalDocument, "processing_3", "processing_4");
 
             // Compare and pick best recognitions
-            for (std::size_t blockIndex{}; blockIndex < document.blocks.size(); blockIndex++) {
-                auto& block = document.blocks[blockIndex];
-                for (std::size_t paragraphIndex{}; paragraphIndex < block.paragraphs.size(); paragraphIndex++) {
-                    auto& paragraph = block.paragraphs[paragraphIndex];
-                    for (std::size_t lineIndex{}; lineIndex < paragraph.lines.size(); lineIndex++) {
-                        auto& line = paragraph.lines[lineIndex];
-                        for (std::size_t wordIndex{}; wordIndex < line.words.size(); wordIndex++) {
-                            auto& word = line.words[wordIndex];
-                            if (word.confidence.getNormalized() > 0.5f) {
-                                continue;
-                            }
-                            const auto wordQuad = make_word_quad(word);
-                            for (const auto& additionalBlock : additionalDocument.blocks) {
-                                for (const auto& additionalParagraph: additionalBlock.paragraphs) {
-                                    for (const auto& additionalLine: additionalParagraph.lines) {
-                                        for (const auto& additionalWord: additionalLine.words) {
-                                            const auto additionalWordQuad = make_word_quad(additionalWord);
-                                            if (wordQuad.coverage(additionalWordQuad) > 0.75f || additionalWordQuad.coverage(wordQuad) > 0.75f) {
-                                                line.words.erase(line.words.begin() + static_cast<int>(wordIndex));
-                                                if (wordIndex > 0) {
-                                                    wordIndex--;
-                                                }
-                                                goto end_word_iteration;
-                                            }
-                                        }
-                                    }
-                                }
-                            }
-end_word_iteration:
-                            {
-                            }
-                        }
-                        if (line.words.empty()) {
-                            paragraph.lines.erase(paragraph.lines.begin() + static_cast<int>(lineIndex));
-                            if (lineIndex > 0) {
-                                lineIndex--;
-                            }
-                        }
-                    }
-                    if (paragraph.lines.empty()) {
-                        block.paragraphs.erase(block.paragraphs.begin() + static_cast<int>(paragraphIndex));
-                        if (paragraphIndex > 0) {
-                            paragraphIndex--;
-                        }
-                    }
-                }
-                if (block.paragraphs.empty()) {
-                    document.blocks.erase(document.blocks.begin() + static_cast<int>(blockIndex));
-                    if (blockIndex > 0) {
-                        blockIndex--;
-                    }
+            // Uncertain words covered by an additional word are dropped, and so are lines, paragraphs and blocks left empty.
+            const auto additionalWordQuads = make_word_quads(additionalDocument.allWords());
+            const QuadGrid additionalWordGrid{ additionalWordQuads };
+            const auto isReplaced = [&](const Word& word) {
+                if (word.confidence.getNormalized() > 0.5f) {
+                    return false;
                 }
-            }
+                bool replaced{ false };
+                additionalWordGrid.forEachCovering(make_word_quad(word), same_area_coverage, [&](std::size_t) {
+                    replaced = true;
+                });
+                return replaced;
+            };
+            document.eraseWords(isReplaced);
 
             // Merge documents
-            document.merge(additionalDocument);
+            document.merge(std::move(additionalDocument));
         }
     }
 
@@ -353,23 +415,7 @@ end_word_iteration:
             processing.processingDateTime = create_processing_date_time();
         }
     }
-    const auto altoXml = alto::to_xml(alto);
-
-    // Save
-    if (task.outputPath.starts_with("smb://")) {
-        sambaClient = acquire_samba_client();
-        if (!sambaClient->writeFile(task.outputPath, altoXml)) {
-            log::error("Failed to write AltoXML file: {}", task.outputPath);
-        }
-        release_samba_client();
-    } else {
-        if (!write_file(task.outputPath, altoXml)) {
-            log::error("Failed to write AltoXML file: {}", task.outputPath);
-        }
-    }
-
-    // Cleanup
-    pixDestroy(&image);
+    return { task, alto::to_xml(alto) };
 }
 
 std::vector<int> TaskProcessor::runTextAngleClassifier(const std::vector<Quad>& quads, const Settings& settings, PIX* pix) {
@@ -417,7 +463,7 @@ const TextRecognizer* TaskProcessor::getTextRecognizer(std::string_view name) co
     if (name == "Tesseract") {
         return tesseractTextRecognizer.get();
     } else if (name == "Paddle") {
-        log::error("Paddle text recognition not yet supported.");
+        return paddleTextRecognizer.get();
     } else if (name == "HuginMunin") {
         return huginMuninTextRecognizer.get();
     }
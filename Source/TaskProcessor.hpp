@@ -3,7 +3,9 @@
 #include "Task.hpp"
 #include "IntegratedTextDetector.hpp"
 #include "Paddle/PaddleTextDetector.hpp"
+#include "Paddle/PaddleTextRecognizer.hpp"
 #include "Tesseract/TesseractTextRecognizer.hpp"
+#include "Tesseract/TesseractEnginePool.hpp"
 #include "Paddle/PaddleTextAngleClassifier.hpp"
 #include "HuginMunin/HuginMuninTextDetector.hpp"
 #include "HuginMunin/HuginMuninTextRecognizer.hpp"
@@ -12,27 +14,70 @@
 #include "Image.hpp"
 #include "Config.hpp"
 #include "Alto/WriteXml.hpp"
+#include "Core/MemoryBudget.hpp"
 
 #include <memory>
-#include <thread>
+#include <optional>
 #include <vector>
 
 namespace frog {
 
-class TaskProcessor {
-public:
+// A task whose input image has been read and decoded, and is ready for text detection and recognition.
+// The decoded image counts towards the memory budget it was loaded with until processing starts.
+struct LoadedTask {
+    Task task;
+    Settings settings;
+    PIX* image{};
+    MemoryBudget* memoryBudget{};
+    std::size_t reservedMemory{};
+
+    LoadedTask(Task task, Settings settings, PIX* image, MemoryBudget* memoryBudget, std::size_t reservedMemory);
+    LoadedTask(const LoadedTask&) = delete;
+    LoadedTask(LoadedTask&& that) noexcept;
+
+    ~LoadedTask();
+
+    LoadedTask& operator=(const LoadedTask&) = delete;
+    LoadedTask& operator=(LoadedTask&& that) noexcept;
+
+    void releaseReservedMemory();
+};
+
+// A task that has been processed, and only needs its output to be written.
+struct CompletedTask {
+    Task task;
+    std::string altoXml;
+};
 
-    TaskProcessor(const Profile& profile);
+// Checks that the task should be processed, and reads and decodes the input image.
+// If a memory budget is given, this blocks before decoding until the decoded image fits in the budget.
+std::optional<LoadedTask> load_task(const Task& task, MemoryBudget* memoryBudget = nullptr);
+void save_task(const CompletedTask& task);
 
-    ~TaskProcessor();
+// Models and engines that are loaded once, and shared by every task processor running the same profile.
+struct SharedTaskResources {
+    PaddleModelRegistry paddleModels;
+    PaddleInferenceServers paddleInferenceServers;
+    std::unique_ptr<TesseractEnginePool> tesseractEngines;
+    std::unique_ptr<HuginMuninWorker> huginMuninTextDetectorWorker;
+    std::unique_ptr<HuginMuninWorker> huginMuninTextRecognizerWorker;
 
-    void pushTask(Task task);
-    bool isFinished() const;
-    void relaunch();
-    int getRemainingTaskCount() const;
+    SharedTaskResources(const Config& config, const Profile& profile);
+};
+
+class TaskProcessor {
+public:
+
+    // Without shared resources, the task processor loads its own models and Tesseract engine.
+    TaskProcessor(const Profile& profile, SharedTaskResources* sharedResources = nullptr);
 
+    // Runs every stage of the task on the calling thread.
     void doTask(const Task& task);
 
+    // Runs text detection, angle classification and text recognition, and creates the AltoXML.
+    // The main text recognition may split the page between up to maxRecognitionEngineCount engines.
+    CompletedTask processTask(const LoadedTask& task, int maxRecognitionEngineCount = 1);
+
 private:
 
     const TextDetector* getTextDetector(std::string_view name) const;
@@ -40,19 +85,11 @@ private:
 
     std::vector<int> runTextAngleClassifier(const std::vector<Quad>& quads, const Settings& settings, PIX* pix);
 
-    std::vector<Task> tasks;
-    Task activeTask;
-    std::thread thread;
-    std::mutex taskMutex;
-
-    // We start with 0 tasks and no thread, so we're technically finished after construction.
-    std::atomic<bool> finished{ true };
-
-    std::atomic<int> remainingTaskCount;
-
+    std::unique_ptr<TesseractEnginePool> ownTesseractEngines;
     std::unique_ptr<IntegratedTextDetector> integratedTextDetector;
     std::unique_ptr<PaddleTextDetector> paddleTextDetector;
     std::unique_ptr<TesseractTextRecognizer> tesseractTextRecognizer;
+    std::unique_ptr<PaddleTextRecognizer> paddleTextRecognizer;
     std::unique_ptr<PaddleTextAngleClassifier> paddleTextAngleClassifier;
     std::unique_ptr<HuginMuninTextRecognizer> huginMuninTextRecognizer;
     std::unique_ptr<HuginMuninTextDetector> huginMuninTextDetector;
@@ -0,0 +1,168 @@
+#include "Tesseract/TesseractEnginePool.hpp"
+#include "Core/Log.hpp"
+
+#include <algorithm>
+
+namespace frog {
+
+static constexpr std::string_view sauvolaThresholdingMethod{ "2" };
+static constexpr std::chrono::milliseconds affinityWait{ 250 };
+
+TesseractEngineLease::TesseractEngineLease(TesseractEngineLease&& that) noexcept : pool{ that.pool }, engine{ that.engine } {
+    that.pool = nullptr;
+    that.engine = nullptr;
+}
+
+TesseractEngineLease::~TesseractEngineLease() {
+    if (pool && engine) {
+        pool->release(engine);
+    }
+}
+
+TesseractEnginePool::TesseractEnginePool(TesseractConfig config_, int maxEngineCount_)
+    : config{ std::move(config_) },
+      maxEngineCount{ static_cast<std::size_t>(std::max(maxEngineCount_, 1)) },
+      memoryLimit{ static_cast<std::size_t>(std::max(config.engineMemoryLimitMegabytes, 0)) * 1024 * 1024 } {
+    if (!std::filesystem::exists(config.tessdata)) {
+        log::error("Did not find tessdata directory: {}", config.tessdata);
+    }
+    log::info("Up to {} Tesseract engines will be initialized when needed ({})", maxEngineCount, config.tessdata);
+}
+
+std::optional<TesseractEngineLease> TesseractEnginePool::acquire(std::string_view requestedDataset) {
+    const std::string dataset{ requestedDataset.empty() ? std::string_view{ config.dataset } : requestedDataset };
+    std::unique_lock lock{ mutex };
+    const auto memory = estimateMemory(dataset);
+    const auto affinityDeadline = std::chrono::steady_clock::now() + affinityWait;
+    while (true) {
+        auto leastRecentlyUsed = engines.end();
+        bool datasetBusy{};
+        for (auto engine = engines.begin(); engine != engines.end(); engine++) {
+            if (engine->checkedOut) {
+                datasetBusy = datasetBusy || engine->dataset == dataset;
+                continue;
+            }
+            if (engine->dataset == dataset) {
+                engine->checkedOut = true;
+                return TesseractEngineLease{ *this, engine->api.get() };
+            }
+            if (leastRecentlyUsed == engines.end() || engine->lastUsed < leastRecentlyUsed->lastUsed) {
+                leastRecentlyUsed = engine;
+            }
+        }
+
+        // Loading a dataset takes hundreds of milliseconds, so give a busy engine that has it a moment to be returned.
+        if (datasetBusy && std::chrono::steady_clock::now() < affinityDeadline) {
+            released.wait_until(lock, affinityDeadline);
+            continue;
+        }
+
+        if (hasRoomFor(memory)) {
+            return addEngine(lock, dataset, memory);
+        }
+
+        if (leastRecentlyUsed != engines.end()) {
+            log::info("Evicting Tesseract engine for {} to make room for {}", leastRecentlyUsed->dataset, dataset);
+            auto evicted = std::move(leastRecentlyUsed->api);
+            estimatedMemoryUsed -= leastRecentlyUsed->estimatedMemory;
+            engines.erase(leastRecentlyUsed);
+            lock.unlock();
+            evicted.reset();
+            lock.lock();
+            continue;
+        }
+
+        released.wait(lock);
+    }
+}
+
+std::optional<TesseractEngineLease> TesseractEnginePool::tryAcquireIdle(std::string_view requestedDataset) {
+    const auto dataset = requestedDataset.empty() ? std::string_view{ config.dataset } : requestedDataset;
+    std::lock_guard lock{ mutex };
+    for (auto& engine : engines) {
+        if (!engine.checkedOut && engine.dataset == dataset) {
+            engine.checkedOut = true;
+            return TesseractEngineLease{ *this, engine.api.get() };
+        }
+    }
+    return std::nullopt;
+}
+
+void TesseractEnginePool::release(tesseract::TessBaseAPI* api) {
+    {
+        std::lock_guard lock{ mutex };
+        const auto engine = std::ranges::find_if(engines, [api](const Engine& engine) {
+            return engine.api.get() == api;
+        });
+        if (engine != engines.end()) {
+            engine->checkedOut = false;
+            engine->lastUsed = ++useCounter;
+        }
+    }
+    // Waiting threads may need a specific dataset, so wake all of them.
+    released.notify_all();
+}
+
+bool TesseractEnginePool::hasRoomFor(std::size_t memory) const {
+    const auto fitsCount = engines.size() < maxEngineCount;
+    const auto fitsMemory = memoryLimit == 0 || estimatedMemoryUsed == 0 || estimatedMemoryUsed + memory <= memoryLimit;
+    return fitsCount && fitsMemory;
+}
+
+std::optional<TesseractEngineLease> TesseractEnginePool::addEngine(std::unique_lock<std::mutex>& lock, const std::string& dataset, std::size_t memory) {
+    // Initialize outside the lock, so other threads can check out idle engines meanwhile.
+    engines.emplace_back(Engine{ nullptr, dataset, memory, 0, true });
+    const auto engine = std::prev(engines.end());
+    estimatedMemoryUsed += memory;
+    lock.unlock();
+    auto api = createEngine(dataset);
+    lock.lock();
+    if (!api) {
+        estimatedMemoryUsed -= memory;
+        engines.erase(engine);
+        lock.unlock();
+        released.notify_all();
+        return std::nullopt;
+    }
+    engine->api = std::move(api);
+    return TesseractEngineLease{ *this, engine->api.get() };
+}
+
+std::size_t TesseractEnginePool::estimateMemory(const std::string& dataset) {
+    if (const auto it = estimatedMemoryByDataset.find(dataset); it != estimatedMemoryByDataset.end()) {
+        return it->second;
+    }
+    // The loaded LSTM models take up about as much memory as their traineddata files.
+    std::size_t memory{};
+    for (const auto language : split_string_view(dataset, "+")) {
+        std::error_code errorCode;
+        const auto size = std::filesystem::file_size(config.tessdata / fmt::format("{}.traineddata", language), errorCode);
+        if (!errorCode) {
+            memory += static_cast<std::size_t>(size);
+        }
+    }
+    estimatedMemoryByDataset.emplace(dataset, memory);
+    return memory;
+}
+
+std::unique_ptr<tesseract::TessBaseAPI> TesseractEnginePool::createEngine(const std::string& dataset) const {
+    log::info("Initializing Tesseract for {} ({})", dataset, config.tessdata);
+    auto engine = std::make_unique<tesseract::TessBaseAPI>();
+    if (engine->Init(path_to_string(config.tessdata).c_str(), dataset.c_str(), tesseract::OcrEngineMode::OEM_LSTM_ONLY)) {
+        log::error("Failed to initialize Tesseract for {}.", dataset);
+        return nullptr;
+    }
+    const std::pair<std::string_view, std::string_view> variables[]{
+        { "thresholding_method", sauvolaThresholdingMethod },
+        { "lstm_choice_mode", "2" },
+        { "tessedit_write_images", "true" }
+    };
+    for (const auto& [name, value] : variables) {
+        if (!engine->SetVariable(name.data(), value.data())) {
+            log::warning("Failed to set {} to {}.", name, value);
+        }
+    }
+    return engine;
+}
+
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Config.hpp"
+
+#include <tesseract/baseapi.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+namespace frog {
+
+class TesseractEnginePool;
+
+// Exclusive use of a pooled Tesseract engine. The engine is returned to the pool when the lease is destroyed.
+class TesseractEngineLease {
+public:
+
+    TesseractEngineLease(TesseractEnginePool& pool, tesseract::TessBaseAPI* engine) : pool{ &pool }, engine{ engine } {}
+    TesseractEngineLease(const TesseractEngineLease&) = delete;
+    TesseractEngineLease(TesseractEngineLease&& that) noexcept;
+
+    ~TesseractEngineLease();
+
+    TesseractEngineLease& operator=(const TesseractEngineLease&) = delete;
+    TesseractEngineLease& operator=(TesseractEngineLease&&) = delete;
+
+    tesseract::TessBaseAPI& operator*() const {
+        return *engine;
+    }
+
+    tesseract::TessBaseAPI* operator->() const {
+        return engine;
+    }
+
+private:
+
+    TesseractEnginePool* pool{ nullptr };
+    tesseract::TessBaseAPI* engine{ nullptr };
+
+};
+
+// Up to maxEngineCount initialized Tesseract engines, shared by every task processor.
+// Each engine holds its own copy of the traineddata, so memory scales with the number of concurrent recognitions.
+// Engines are initialized for a dataset (e.g. "nor" or "nor+eng") when first needed, and kept between uses.
+// When the pool is full, or the engines would exceed the memory limit, the least recently used idle engine is evicted.
+class TesseractEnginePool {
+public:
+
+    TesseractEnginePool(TesseractConfig config, int maxEngineCount);
+    TesseractEnginePool(const TesseractEnginePool&) = delete;
+    TesseractEnginePool(TesseractEnginePool&&) = delete;
+
+    // Every lease must have been returned.
+    ~TesseractEnginePool() = default;
+
+    TesseractEnginePool& operator=(const TesseractEnginePool&) = delete;
+    TesseractEnginePool& operator=(TesseractEnginePool&&) = delete;
+
+    // Prefers an idle engine that already has the dataset loaded, and briefly waits for a busy one before loading it again.
+    // An empty dataset means the configured default. Returns std::nullopt if a new engine failed to initialize.
+    std::optional<TesseractEngineLease> acquire(std::string_view dataset = {});
+
+    // Returns an idle engine that already has the dataset loaded, without waiting, initializing or evicting anything.
+    // Returns std::nullopt if there is none.
+    std::optional<TesseractEngineLease> tryAcquireIdle(std::string_view dataset = {});
+
+private:
+
+    friend class TesseractEngineLease;
+
+    struct Engine {
+        std::unique_ptr<tesseract::TessBaseAPI> api;
+        std::string dataset;
+        std::size_t estimatedMemory{};
+        std::uint64_t lastUsed{};
+        bool checkedOut{};
+    };
+
+    void release(tesseract::TessBaseAPI* engine);
+    bool hasRoomFor(std::size_t memory) const;
+    std::optional<TesseractEngineLease> addEngine(std::unique_lock<std::mutex>& lock, const std::string& dataset, std::size_t memory);
+    std::unique_ptr<tesseract::TessBaseAPI> createEngine(const std::string& dataset) const;
+    std::size_t estimateMemory(const std::string& dataset);
+
+    const TesseractConfig config;
+    const std::size_t maxEngineCount;
+    const std::size_t memoryLimit; // 0 means no limit.
+
+    std::mutex mutex;
+    std::condition_variable released;
+    std::list<Engine> engines; // Including engines checked out, or being initialized.
+    std::unordered_map<std::string, std::size_t> estimatedMemoryByDataset;
+    std::size_t estimatedMemoryUsed{};
+    std::uint64_t useCounter{};
+
+};
+
+}
@@ -1,6 +1,9 @@
 #include "Tesseract/TesseractTextRecognizer.hpp"
 #include "Image.hpp"
 
+#include <atomic>
+#include <thread>
+
 namespace frog {
 
 struct BuildState {
@@ -9,8 +12,6 @@ struct BuildState {
     float lineAngleInDegrees{};
 };
 
-static constexpr std::string_view sauvolaThresholdingMethod{ "2" };
-
 static thread_local int progressChangeRequiredToNotifyProgressCallback{ 1 };
 static thread_local std::function<void(int, int, int, int, int)> threadLocalTesseractProgressCallback;
 static thread_local std::function<bool(void*, int)> threadLocalTesseractCancelCallback;
@@ -58,32 +59,32 @@ static bool setTesseractVariable(tesseract::TessBaseAPI& tesseract, std::string_
     return false;
 }
 
-void on_symbol(Word& word, BuildState buildState, tesseract::ResultIterator* symbolIterator) {
-    Symbol symbol;
+// Each level is added to the document before its children, which then belong to it.
+void on_symbol(Document& document, BuildState buildState, tesseract::ResultIterator* symbolIterator) {
+    auto& symbol = document.addSymbol();
     symbolIterator->BoundingBox(tesseract::RIL_SYMBOL, &symbol.x, &symbol.y, &symbol.width, &symbol.height);
     symbol.width -= symbol.x;
     symbol.height -= symbol.y;
     symbol.x += buildState.offsetX;
     symbol.y += buildState.offsetY;
     auto text = symbolIterator->GetUTF8Text(tesseract::RIL_SYMBOL);
-    symbol.text = text;
+    const std::string_view symbolText{ text ? text : "" };
+    symbol.text = document.addText(symbolText);
     symbol.confidence = { symbolIterator->Confidence(tesseract::RIL_SYMBOL), Confidence::Format::percent };
     tesseract::ChoiceIterator symbolChoiceIterator{ *symbolIterator };
     do {
         // It is correct to not free choiceText.
-        if (auto choiceText = symbolChoiceIterator.GetUTF8Text(); choiceText && symbol.text != choiceText) {
-            Variant variant;
-            variant.text = choiceText;
+        if (auto choiceText = symbolChoiceIterator.GetUTF8Text(); choiceText && symbolText != choiceText) {
+            auto& variant = document.addVariant();
+            variant.text = document.addText(choiceText);
             variant.confidence = { symbolChoiceIterator.Confidence(), Confidence::Format::percent };
-            symbol.variants.push_back(variant);
         }
     } while (symbolChoiceIterator.Next());
     delete[] text;
-    word.symbols.push_back(symbol);
 }
 
-void on_word(Line& line, BuildState buildState, std::vector<Font>& fonts, tesseract::ResultIterator* wordIterator) {
-    Word word;
+void on_word(Document& document, BuildState buildState, tesseract::ResultIterator* wordIterator) {
+    auto& word = document.addWord();
     wordIterator->BoundingBox(tesseract::RIL_WORD, &word.x, &word.y, &word.width, &word.height);
     word.width -= word.x;
     word.height -= word.y;
@@ -91,10 +92,11 @@ void on_word(Line& line, BuildState buildState, std::vector<Font>& fonts, tesser
     word.y += buildState.offsetY;
     auto text = wordIterator->GetUTF8Text(tesseract::RIL_WORD);
     if (!text) {
+        document.removeLastWord();
         return; // Most likely a blank image.
     }
     word.confidence = { wordIterator->Confidence(tesseract::RIL_WORD), Confidence::Format::percent };
-    word.text = text;
+    word.text = document.addText(text);
     delete[] text;
     bool bold{ false };
     bool italic{ false };
@@ -107,6 +109,7 @@ void on_word(Line& line, BuildState buildState, std::vector<Font>& fonts, tesser
     const char* wordFontNameResult = wordIterator->WordFontAttributes(&bold, &italic, &underlined, &monospace, &serif, &smallcaps, &wordFontSize, &fontId);
     const std::string_view wordFontName{ wordFontNameResult ? wordFontNameResult : "" };
     int styleRefs{};
+    auto& fonts = document.fonts;
     for (const auto& [fontName, fontSize]: fonts) {
         if (fontName == wordFontName && fontSize == wordFontSize) {
             word.styleRefs = styleRefs;
@@ -120,16 +123,15 @@ void on_word(Line& line, BuildState buildState, std::vector<Font>& fonts, tesser
     }
     auto symbolIterator = wordIterator;
     do {
-        on_symbol(word, buildState, symbolIterator);
+        on_symbol(document, buildState, symbolIterator);
         if (symbolIterator->IsAtFinalElement(tesseract::RIL_WORD, tesseract::RIL_SYMBOL)) {
             break;
         }
     } while (symbolIterator->Next(tesseract::RIL_SYMBOL));
-    line.words.push_back(word);
 }
 
-void on_line(Paragraph& paragraph, BuildState buildState, std::vector<Font>& fonts, tesseract::ResultIterator* lineIterator) {
-    Line line;
+void on_line(Document& document, BuildState buildState, tesseract::ResultIterator* lineIterator) {
+    auto& line = document.addLine();
     lineIterator->BoundingBox(tesseract::RIL_TEXTLINE, &line.x, &line.y, &line.width, &line.height);
     line.width -= line.x;
     line.height -= line.y;
@@ -137,19 +139,18 @@ void on_line(Paragraph& paragraph, BuildState buildState, std::vector<Font>& fon
     line.y += buildState.offsetY;
     auto wordIterator = lineIterator;
     do {
-        on_word(line, buildState, fonts, wordIterator);
+        on_word(document, buildState, wordIterator);
         if (wordIterator->IsAtFinalElement(tesseract::RIL_TEXTLINE, tesseract::RIL_WORD)) {
             break;
         }
     } while (wordIterator->Next(tesseract::RIL_WORD));
-    if (!line.words.empty()) {
-        line.styleRefs = line.words[0].styleRefs;
+    if (const auto words = document.words(line); !words.empty()) {
+        line.styleRefs = words.front().styleRefs;
     }
-    paragraph.lines.push_back(line);
 }
 
-void on_paragraph(Block& block, BuildState buildState, std::vector<Font>& fonts, tesseract::ResultIterator* paragraphIterator) {
-    Paragraph paragraph;
+void on_paragraph(Document& document, BuildState buildState, tesseract::ResultIterator* paragraphIterator) {
+    auto& paragraph = document.addParagraph();
     paragraphIterator->BoundingBox(tesseract::RIL_PARA, &paragraph.x, &paragraph.y, &paragraph.width, &paragraph.height);
     paragraph.width -= paragraph.x;
     paragraph.height -= paragraph.y;
@@ -158,16 +159,15 @@ void on_paragraph(Block& block, BuildState buildState, std::vector<Font>& fonts,
     paragraph.angleInDegrees = buildState.lineAngleInDegrees;
     auto lineIterator = paragraphIterator;
     do {
-        on_line(paragraph, buildState, fonts, lineIterator);
+        on_line(document, buildState, lineIterator);
         if (lineIterator->IsAtFinalElement(tesseract::RIL_PARA, tesseract::RIL_TEXTLINE)) {
             break;
         }
     } while (lineIterator->Next(tesseract::RIL_TEXTLINE));
-    block.paragraphs.push_back(paragraph);
 }
 
 void on_block(Document& document, BuildState buildState, tesseract::ResultIterator* blockIterator) {
-    Block block;
+    auto& block = document.addBlock();
     blockIterator->BoundingBox(tesseract::RIL_BLOCK, &block.x, &block.y, &block.width, &block.height);
     block.width -= block.x;
     block.height -= block.y;
@@ -175,12 +175,11 @@ void on_block(Document& document, BuildState buildState, tesseract::ResultIterat
     block.y += buildState.offsetY;
     auto paragraphIterator = blockIterator;
     do {
-        on_paragraph(block, buildState, document.fonts, paragraphIterator);
+        on_paragraph(document, buildState, paragraphIterator);
         if (paragraphIterator->IsAtFinalElement(tesseract::RIL_BLOCK, tesseract::RIL_PARA)) {
             break;
         }
     } while (paragraphIterator->Next(tesseract::RIL_PARA));
-    document.blocks.push_back(block);
 }
 
 void recognize_all(tesseract::TessBaseAPI& tesseract, PIX* pix) {
@@ -206,19 +205,8 @@ void build_from_result_iterator(Document& document, tesseract::ResultIterator* r
     } while (resultIterator->Next(tesseract::RIL_BLOCK));
 }
 
-TesseractTextRecognizer::TesseractTextRecognizer(const TesseractConfig& config) {
-    if (!std::filesystem::exists(config.tessdata)) {
-        log::error("Did not find tessdata directory: {}", config.tessdata);
-        return;
-    }
-    log::info("Initializing Tesseract ({})", config.tessdata);
-    if (tesseract.Init(path_to_string(config.tessdata).c_str(), config.dataset.c_str(), tesseract::OcrEngineMode::OEM_LSTM_ONLY)) {
-        log::error("Failed to initialize Tesseract.");
-        return;
-    }
-    setTesseractVariable(tesseract, "thresholding_method", sauvolaThresholdingMethod);
-    setTesseractVariable(tesseract, "lstm_choice_mode", "2");
-    setTesseractVariable(tesseract, "tessedit_write_images", "true");
+TesseractTextRecognizer::TesseractTextRecognizer(TesseractEnginePool& engines_) : engines{ engines_ } {
+
 }
 
 static std::pair<float, PIX*> test_confidence(tesseract::TessBaseAPI& tesseract, PIX* pix, int angle) {
@@ -235,10 +223,7 @@ static std::pair<float, PIX*> test_confidence(tesseract::TessBaseAPI& tesseract,
     return { static_cast<float>(tesseract.MeanTextConf()) / 100.0f, rotatedPix };
 }
 
-Document TesseractTextRecognizer::recognize(PIX* image, const std::vector<Quad>& quads, std::vector<int> angles, const TextRecognitionSettings& settings) const {
-    Document document;
-    BuildState buildState;
-
+static void configure_engine(tesseract::TessBaseAPI& tesseract, const TextRecognitionSettings& settings) {
     setTesseractVariable(tesseract, "thresholding_kfactor", std::to_string(settings.sauvolaKFactor));
     setTesseractVariable(tesseract, "tessedit_char_whitelist", settings.characterWhitelist);
 
@@ -253,6 +238,99 @@ Document TesseractTextRecognizer::recognize(PIX* image, const std::vector<Quad>&
     } else if (settings.pageSegmentation == PageSegmentation::sparse) {
         tesseract.SetPageSegMode(tesseract::PageSegMode::PSM_SPARSE_TEXT);
     }
+}
+
+// The angle is updated if the line turns out to be upside down.
+static void recognize_quad(tesseract::TessBaseAPI& tesseract, PIX* image, const Quad& quad, int& angle, Document& document, BuildState& buildState) {
+    // Crop, deskew and rotate to match predicted angle in one pass.
+    auto pix = crop_and_deskew_quad(image, quad, angle == 180);
+
+    // Run recognition for predicted angle, and try the opposite direction if confidence is bad.
+    recognize_all(tesseract, pix);
+    if (tesseract.MeanTextConf() < 40) {
+        const auto confidence = tesseract.MeanTextConf();
+
+        // Try 180 rotation. The line is rotated in place, and back again if it did not help.
+        pixRotate180(pix, pix);
+        recognize_all(tesseract, pix);
+        if (tesseract.MeanTextConf() > confidence + 10) {
+            angle = (angle + 180) % 360;
+        } else {
+            pixRotate180(pix, pix);
+            recognize_all(tesseract, pix);
+        }
+    }
+
+    // Build document.
+    if (auto resultIterator = tesseract.GetIterator()) {
+        build_from_result_iterator(document, resultIterator, quad, buildState);
+    }
+
+    pixDestroy(&pix);
+}
+
+static Confidence get_mean_word_confidence(const Document& document) {
+    float confidence{};
+    const auto words = document.allWords();
+    for (const auto& word : words) {
+        confidence += word.confidence.getNormalized();
+    }
+    if (!words.empty()) {
+        confidence /= static_cast<float>(words.size());
+    }
+    return { confidence, Confidence::Format::normalized };
+}
+
+void TesseractTextRecognizer::recognizeInParallel(tesseract::TessBaseAPI& tesseract, PIX* image, const std::vector<Quad>& quads, std::vector<int>& angles, const TextRecognitionSettings& settings, Document& document) const {
+    // Each quad is built into its own document, so they can be merged in reading order regardless of which engine finished first.
+    std::vector<Document> quadDocuments(quads.size());
+    std::atomic<std::size_t> nextQuadIndex{ 0 };
+    const auto recognizeQuads = [&](tesseract::TessBaseAPI& quadTesseract) {
+        BuildState buildState;
+        for (auto quadIndex = nextQuadIndex++; quadIndex < quads.size(); quadIndex = nextQuadIndex++) {
+            recognize_quad(quadTesseract, image, quads[quadIndex], angles[quadIndex], quadDocuments[quadIndex], buildState);
+        }
+    };
+
+    // Only idle engines that already have the dataset loaded are borrowed, so a page never waits for another task to return
+    // an engine, nor for a new one to be initialized.
+    const auto maxHelperCount = std::min(static_cast<std::size_t>(settings.maxEngineCount), quads.size()) - 1;
+    std::vector<TesseractEngineLease> helperEngines;
+    while (helperEngines.size() < maxHelperCount) {
+        auto helperEngine = engines.tryAcquireIdle(settings.language);
+        if (!helperEngine) {
+            break;
+        }
+        helperEngines.emplace_back(std::move(helperEngine.value()));
+    }
+    std::vector<std::thread> helpers;
+    for (auto& helperEngine : helperEngines) {
+        helpers.emplace_back([&settings, &recognizeQuads, &helperEngine] {
+            configure_engine(*helperEngine, settings);
+            recognizeQuads(*helperEngine);
+        });
+    }
+    recognizeQuads(tesseract);
+    for (auto& helper : helpers) {
+        helper.join();
+    }
+
+    for (auto& quadDocument : quadDocuments) {
+        document.merge(std::move(quadDocument));
+    }
+}
+
+Document TesseractTextRecognizer::recognize(PIX* image, const std::vector<Quad>& quads, std::vector<int> angles, const TextRecognitionSettings& settings) const {
+    auto engine = engines.acquire(settings.language);
+    if (!engine) {
+        return {};
+    }
+    auto& tesseract = **engine;
+
+    Document document;
+    BuildState buildState;
+
+    configure_engine(tesseract, settings);
 
     if (quads.size() == 1) {
         const auto& quad = quads.front();
@@ -265,102 +343,14 @@ Document TesseractTextRecognizer::recognize(PIX* image, const std::vector<Quad>&
                 on_block(document, buildState, resultIterator);
             } while (resultIterator->Next(tesseract::RIL_BLOCK));
         }
+    } else if (settings.maxEngineCount > 1 && quads.size() > 1) {
+        recognizeInParallel(tesseract, image, quads, angles, settings, document);
+        document.confidence = get_mean_word_confidence(document);
     } else {
-        std::size_t quadIndex{};
-        for (const auto& quad : quads) {
-            auto clippedPix = copy_pixels_in_quad(image, quad);
-            auto pix = pixRotate(clippedPix, -quad.bottomRightToLeftAngle(), L_ROTATE_AREA_MAP, L_BRING_IN_WHITE, 0, 0);
-
-            // Rotate to match predicted angle.
-            if (angles[quadIndex] == 180) {
-                pixRotate180(pix, pix);
-            }
-
-            // Run recognition for predicted angle, and try other rotations if confidence is bad.
-            recognize_all(tesseract, pix);
-            if (tesseract.MeanTextConf() < 40) {
-                // Keep track of the best pix so far.
-                auto bestConfidence = tesseract.MeanTextConf();
-                auto bestAngle = angles[quadIndex];
-                auto bestPix = pix;
-
-                // Try 180 rotation.
-                auto rotated180Pix = pixRotate180(nullptr, pix);
-                recognize_all(tesseract, rotated180Pix);
-                auto lastPix = rotated180Pix;
-                if (tesseract.MeanTextConf() > bestConfidence + 10) {
-                    bestConfidence = tesseract.MeanTextConf();
-                    bestAngle = angles[quadIndex] + 180;
-                    bestPix = rotated180Pix;
-                }
-
-#if 0
-                // Try 90 rotation.
-                PIX* rotated90Pix{};
-                if (bestConfidence < 50 && bestConfidence > 1) {
-                    rotated90Pix = pixRotate90(pix, 1);
-                    recognize_all(tesseract, rotated90Pix);
-                    lastPix = rotated90Pix;
-                    if (tesseract.MeanTextConf() > bestConfidence + 30) {
-                        bestConfidence = tesseract.MeanTextConf();
-                        bestAngle = angles[quadIndex] + 90;
-                        bestPix = rotated90Pix;
-                    }
-                }
-
-                // Try 270 rotation.
-                PIX* rotated270Pix{};
-                if (bestConfidence < 50 && bestConfidence > 1) {
-                    rotated270Pix = pixRotate90(pix, -1);
-                    recognize_all(tesseract, rotated270Pix);
-                    lastPix = rotated270Pix;
-                    if (tesseract.MeanTextConf() > bestConfidence + 30) {
-                        bestConfidence = tesseract.MeanTextConf();
-                        bestAngle = angles[quadIndex] + 270;
-                        bestPix = rotated270Pix;
-                    }
-                }
-#endif
-
-                // Rerun recognition for best angle if necessary.
-                angles[quadIndex] = bestAngle % 360;
-                if (lastPix != bestPix) {
-                    recognize_all(tesseract, bestPix);
-                }
-
-                // Clean up
-                pixDestroy(&rotated180Pix);
-#if 0
-                pixDestroy(&rotated90Pix);
-                pixDestroy(&rotated270Pix);
-#endif
-            }
-
-            // Build document.
-            if (auto resultIterator = tesseract.GetIterator()) {
-                build_from_result_iterator(document, resultIterator, quad, buildState);
-            }
-
-            pixDestroy(&pix);
-            pixDestroy(&clippedPix);
-            quadIndex++;
-        }
-        float confidence{};
-        int wordCount{};
-        for (const auto& block : document.blocks) {
-            for (const auto& paragraph : block.paragraphs) {
-                for (const auto& line : paragraph.lines) {
-                    for (const auto& word : line.words) {
-                        confidence += word.confidence.getNormalized();
-                        wordCount++;
-                    }
-                }
-            }
-        }
-        if (wordCount > 0) {
-            confidence /= static_cast<float>(wordCount);
+        for (std::size_t quadIndex{}; quadIndex < quads.size(); quadIndex++) {
+            recognize_quad(tesseract, image, quads[quadIndex], angles[quadIndex], document, buildState);
         }
-        document.confidence = { confidence, Confidence::Format::normalized };
+        document.confidence = get_mean_word_confidence(document);
     }
 
     std::unordered_map<int, int> angleCounts;
@@ -2,22 +2,28 @@
 
 #include "TextRecognizer.hpp"
 #include "Config.hpp"
+#include "Tesseract/TesseractEnginePool.hpp"
 
 #include <tesseract/baseapi.h>
 #include <tesseract/ocrclass.h>
 
 namespace frog {
 
+// Checks out an engine from the pool for each call to recognize, so it is safe to call from several threads at once.
+// The engine is initialized for the language in the recognition settings, or the profile's dataset if none is set.
+// If the settings allow more than one engine, the lines of the page are shared between the engines that are idle.
 class TesseractTextRecognizer : public TextRecognizer {
 public:
 
-    TesseractTextRecognizer(const TesseractConfig& config);
+    TesseractTextRecognizer(TesseractEnginePool& engines);
 
     Document recognize(PIX* image, const std::vector<Quad>& quads, std::vector<int> angles, const TextRecognitionSettings& settings) const override;
 
 private:
 
-    mutable tesseract::TessBaseAPI tesseract;
+    void recognizeInParallel(tesseract::TessBaseAPI& tesseract, PIX* image, const std::vector<Quad>& quads, std::vector<int>& angles, const TextRecognitionSettings& settings, Document& document) const;
+
+    TesseractEnginePool& engines;
 
 };
 